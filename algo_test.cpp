@@ -0,0 +1,141 @@
+// checks the intersection kernels against std::set_intersection on random sorted inputs:
+// multisets through count_intersection / intersection, sets through the SIMD/galloping
+// count_set_intersection / set_intersection. for_each_union of several sets, dense (bitmap) and
+// sparse (heap), against std::set_union. And parallel_sort of a table with trivially
+// copyable and string columns against std::stable_sort of its rows.
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <list>
+#include <random>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "os/algo.hpp"
+
+template <typename T>
+std::vector<T> sorted_values(std::mt19937& rng, std::size_t size, T universe, bool unique) {
+  std::uniform_int_distribution<T> value(0, universe);
+  std::vector<T>                   v(size);
+  for (auto& x: v) x = value(rng);
+  std::sort(v.begin(), v.end());
+  if (unique) v.erase(std::unique(v.begin(), v.end()), v.end());
+  return v;
+}
+
+template <typename T>
+int check(std::mt19937& rng, bool unique) {
+  std::uniform_int_distribution<std::size_t> size(0, 300);
+  int                                        failures = 0;
+  for (int i = 0; i != 2000; ++i) {
+    // small universes give many repeats, the last cases have very different sizes (galloping)
+    const auto a = sorted_values<T>(rng, size(rng), i % 2 ? 50 : 1000, unique);
+    const auto b = sorted_values<T>(rng, i > 1800 ? 100 * size(rng) : size(rng), 1000, unique);
+
+    std::vector<T> expected;
+    std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(expected));
+
+    const std::list<T> la(a.begin(), a.end());
+    const std::list<T> lb(b.begin(), b.end());
+    bool ok = os::algo::count_intersection(a, b) == expected.size() &&
+              os::algo::count_intersection(la, lb) == expected.size() &&
+              os::algo::intersection(a, b) == expected;
+    if (unique) {
+      ok = ok && os::algo::count_set_intersection(a, b) == expected.size() &&
+           os::algo::set_intersection(a, b) == expected;
+    }
+    if (!ok) ++failures;
+  }
+  return failures;
+}
+
+// dense sets around `base`, sometimes with an outlier that makes the span too wide for the bitmap
+template <typename T>
+int check_union(std::mt19937& rng, T base) {
+  std::uniform_int_distribution<std::size_t> size(0, 200);
+  std::uniform_int_distribution<int>         lists(1, 6);
+  int                                        failures = 0;
+  for (int i = 0; i != 500; ++i) {
+    std::vector<std::vector<T>> sets(static_cast<std::size_t>(lists(rng)));
+    std::vector<T>              expected;
+    for (auto& set: sets) {
+      for (const T v: sorted_values<T>(rng, size(rng), 500, true))
+        set.push_back(static_cast<T>(base + v));
+      if (i % 3 == 0) set.push_back(std::numeric_limits<T>::max());
+      std::vector<T> next;
+      std::set_union(expected.begin(), expected.end(), set.begin(), set.end(),
+                     std::back_inserter(next));
+      expected.swap(next);
+    }
+    std::vector<std::list<T>> as_lists; // not random access, so always the heap
+    for (const auto& set: sets) as_lists.emplace_back(set.begin(), set.end());
+
+    std::vector<T> got;
+    std::vector<T> got_lists;
+    os::algo::for_each_union(sets, [&](T v) { got.push_back(v); });
+    os::algo::for_each_union(as_lists, [&](T v) { got_lists.push_back(v); });
+    if (got != expected || got_lists != expected) ++failures;
+  }
+  return failures;
+}
+
+// `threads` as in sort_options. the radix path is stable, so the order of rows must match exactly
+int check_sort(std::mt19937& rng, unsigned threads) {
+  std::uniform_int_distribution<int> key(-500, 500); // NOLINT
+  int                                failures = 0;
+  for (std::size_t size: {0, 1, 100, 10'001}) { // NOLINT
+    std::vector<int>                                  keys(size);
+    std::vector<double>                               values(size);
+    std::vector<std::string>                          names(size);
+    std::vector<std::tuple<int, double, std::string>> rows;
+    for (std::size_t i = 0; i != size; ++i) {
+      keys[i]   = key(rng);
+      values[i] = static_cast<double>(i);
+      names[i]  = std::to_string(i);
+      rows.emplace_back(keys[i], values[i], names[i]);
+    }
+    std::stable_sort(rows.begin(), rows.end(), [](const auto& a, const auto& b) {
+      return std::get<0>(a) < std::get<0>(b);
+    });
+    // named options and comparator, as well as temporaries
+    if (size % 2 == 0) {
+      os::algo::parallel_sort(os::algo::sort_options{threads}, std::less<>{}, keys, values, names);
+    } else {
+      os::algo::sort_options options{threads};
+      auto                   less = std::less<>{};
+      os::algo::parallel_sort(options, less, keys, values, names);
+    }
+    for (std::size_t i = 0; i != size; ++i)
+      if (rows[i] != std::tuple(keys[i], values[i], names[i])) {
+        ++failures;
+        break;
+      }
+  }
+  return failures;
+}
+
+int main() {
+  std::mt19937 rng(42); // NOLINT
+  int          failures = 0;
+  for (const bool unique: {false, true}) {
+    failures += check<std::int32_t>(rng, unique);
+    failures += check<std::uint32_t>(rng, unique);
+    failures += check<std::int64_t>(rng, unique);
+    failures += check<std::uint64_t>(rng, unique);
+  }
+  std::cout << (failures == 0 ? "intersection: ok\n" : "intersection: FAILED\n");
+
+  int union_failures = check_union<std::int32_t>(rng, -250) + check_union<std::uint32_t>(rng, 0) +
+                       check_union<std::int64_t>(rng, std::numeric_limits<std::int64_t>::min()) +
+                       check_union<std::uint64_t>(rng, 1U << 31U) +
+                       check_union<std::int16_t>(rng, -300);
+  std::cout << (union_failures == 0 ? "union: ok\n" : "union: FAILED\n");
+
+  int sort_failures = 0;
+  for (const unsigned threads: {1U, 0U, 3U}) sort_failures += check_sort(rng, threads);
+  std::cout << (sort_failures == 0 ? "parallel_sort: ok\n" : "parallel_sort: FAILED\n");
+  return failures == 0 && union_failures == 0 && sort_failures == 0 ? 0 : 1;
+}
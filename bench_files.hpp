@@ -0,0 +1,36 @@
+// input files shared by the file reading benchmarks
+#pragma once
+#include <cstddef>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// lines of 1 to 120 'x', unless the file already exists with at least `size` bytes
+inline void generate(const std::string& filename, std::size_t size) {
+  struct stat sbuf {};
+  if (stat(filename.c_str(), &sbuf) == 0 && static_cast<std::size_t>(sbuf.st_size) >= size) return;
+
+  std::cerr << "generating " << (size >> 20U) << " MB in " << filename << '\n';
+  std::ofstream                   out(filename, std::ios::binary);
+  std::mt19937                    rng(42);     // NOLINT
+  std::uniform_int_distribution<> len(1, 120); // NOLINT
+  std::string                     line;
+  for (std::size_t written = 0; written < size; written += line.size()) {
+    line.assign(static_cast<std::size_t>(len(rng)), 'x');
+    line += '\n';
+    out << line;
+  }
+}
+
+// written pages must reach the disk before they can be evicted
+inline void drop_cache(const std::string& filename) {
+  int fd = open(filename.c_str(), O_RDONLY); // NOLINT
+  if (fd == -1) return;
+  fdatasync(fd);
+  posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+  close(fd);
+}
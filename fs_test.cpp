@@ -0,0 +1,37 @@
+// checks what os::fs::FileWriter writes for each kind of argument: string literals, C strings,
+// std::string(_view), chars, bools and numbers, through append() and operator<<
+// usage: fs_test [file]
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+#include "os/fs.hpp"
+
+int main(int argc, char* argv[]) {
+  const std::string filename = argc > 1 ? argv[1] : "fs_test.txt";
+
+  const char*       c_str = "ptr";
+  const std::string str   = "str";
+  {
+    os::fs::FileWriter w(filename);
+    w << "text" << ' ' << 42 << ' ' << c_str << '\n';
+    w.append("lit");
+    w.append(c_str);
+    w << true << false << str << std::string_view("view") << -1.5 << 'c';
+  }
+  std::ifstream     in(filename);
+  std::stringstream contents;
+  contents << in.rdbuf();
+  std::remove(filename.c_str());
+
+  const std::string expected = "text 42 ptr\nlitptr10strview-1.5c";
+  if (contents.str() != expected) {
+    std::cerr << "FileWriter: FAILED, got \"" << contents.str() << "\"\n";
+    return 1;
+  }
+  std::cout << "FileWriter: ok\n";
+  return 0;
+}
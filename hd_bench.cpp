@@ -0,0 +1,132 @@
+// checks os::hex_dump against the previous iostream manipulator implementation, for all
+// alignments and lengths, and compares their speed on a large buffer
+// usage: hd_bench [size_mb]
+#include <cctype>
+#include <cstddef>
+#include <fcntl.h>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "os/bch.hpp"
+#include "os/debug.hpp"
+
+// the implementation before the line buffered one, the reference for the output
+namespace reference {
+
+inline void print_adr(std::ostream& os, const std::byte* adr) {
+  os << std::setw(19) << std::setfill(' ') << adr; // NOLINT
+}
+
+inline void print_fill_advance(std::ostream& os, const std::byte*& buf, std::size_t cnt,
+                               const std::string& str) {
+  while (cnt-- != 0U) {
+    ++buf; // NOLINT
+    os << str;
+  }
+}
+
+inline void print_hex(std::ostream& os, const std::byte* buf, std::size_t linesize, std::size_t pre,
+                      std::size_t post) {
+  print_fill_advance(os, buf, pre, "-- ");
+  {
+    os << std::setfill('0') << std::hex;
+    auto cnt = linesize - pre - post;
+    while (cnt-- != 0U) os << std::setw(2) << static_cast<unsigned>(*buf++) << ' '; // NOLINT
+  }
+  print_fill_advance(os, buf, post, "-- ");
+}
+
+inline void print_ascii(std::ostream& os, const std::byte* buf, std::size_t linesize,
+                        std::size_t pre, std::size_t post) {
+  print_fill_advance(os, buf, pre, ".");
+  auto cnt = linesize - pre - post;
+  while (cnt-- != 0U) {
+    os << (std::isprint(static_cast<unsigned char>(*buf)) != 0 ? static_cast<char>(*buf) : '.');
+    ++buf; // NOLINT
+  }
+  print_fill_advance(os, buf, post, ".");
+}
+
+inline std::ostream& hex_dump(std::ostream& os, const std::byte* buffer, std::size_t bufsize) {
+  if (buffer == nullptr || bufsize == 0) return os;
+
+  constexpr std::size_t linesize{16};
+  const std::byte*      buf{buffer};
+  std::size_t           pre = reinterpret_cast<std::size_t>(buffer) % linesize; // NOLINT
+  bufsize += pre;
+  buf -= pre; // NOLINT
+
+  auto state = os::ostream_state{os};
+  while (bufsize != 0U) {
+    std::size_t post = bufsize < linesize ? linesize - bufsize : 0;
+
+    print_adr(os, buf);
+    os << ": ";
+    print_hex(os, buf, linesize, pre, post);
+    os << " | ";
+    print_ascii(os, buf, linesize, pre, post);
+    os << "\n";
+
+    buf += linesize; // NOLINT
+    bufsize -= linesize - post;
+    pre = 0;
+  }
+  return os;
+}
+
+} // namespace reference
+
+template <typename Dump>
+std::string dump_to_string(Dump dump, const std::byte* buf, std::size_t size, bool upper = false) {
+  std::ostringstream ss;
+  if (upper) ss << std::uppercase;
+  dump(ss, buf, size);
+  return ss.str();
+}
+
+int main(int argc, char* argv[]) {
+  const std::size_t size = (argc > 1 ? std::stoul(argv[1]) : 16) << 20U; // NOLINT
+
+  std::mt19937           rng(42); // NOLINT
+  std::vector<std::byte> data(size + 64);
+  for (auto& b: data) b = static_cast<std::byte>(rng());
+
+  using dump_fn = std::ostream& (*)(std::ostream&, const std::byte*, std::size_t);
+  const dump_fn old_dump = reference::hex_dump;
+  const dump_fn new_dump = os::hex_dump;
+
+  // every start alignment and length up to a few lines, both cases
+  int failures = 0;
+  for (std::size_t offset = 0; offset != 16; ++offset)
+    for (std::size_t len = 0; len != 80; ++len) // NOLINT
+      for (bool upper: {false, true})
+        if (dump_to_string(old_dump, data.data() + offset, len, upper) !=
+            dump_to_string(new_dump, data.data() + offset, len, upper))
+          ++failures;
+
+  std::string old_out;
+  std::string new_out;
+  {
+    os::bch::Timer t("iostream hex_dump");
+    old_out = dump_to_string(old_dump, data.data() + 3, size);
+  }
+  {
+    os::bch::Timer t("buffered hex_dump");
+    new_out = dump_to_string(new_dump, data.data() + 3, size);
+  }
+  if (old_out != new_out) ++failures;
+  {
+    const int      fd = open("/dev/null", O_WRONLY); // NOLINT
+    os::bch::Timer t("hex_dump to fd");
+    os::hex_dump(fd, data.data() + 3, size);
+    close(fd);
+  }
+
+  std::cout << (failures == 0 ? "output identical\n" : "OUTPUT DIFFERS\n");
+  return failures == 0 ? 0 : 1;
+}
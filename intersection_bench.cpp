@@ -0,0 +1,73 @@
+// compares N-way intersection / union with chaining pairwise calls
+// usage: intersection_bench [num_lists] [smallest_list_size]
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "os/algo.hpp"
+#include "os/bch.hpp"
+
+using list_t = std::vector<std::uint32_t>;
+
+// sorted, unique ids, each present with probability `density`
+list_t make_list(std::mt19937& rng, double density, std::uint32_t universe) {
+  list_t list;
+  list.reserve(static_cast<std::size_t>(density * universe));
+  std::bernoulli_distribution pick(density);
+  for (std::uint32_t id = 0; id != universe; ++id)
+    if (pick(rng)) list.push_back(id);
+  return list;
+}
+
+int main(int argc, char* argv[]) {
+  const std::size_t num_lists = argc > 1 ? std::stoul(argv[1]) : 10;       // NOLINT
+  const std::size_t smallest  = argc > 2 ? std::stoul(argv[2]) : 100'000;  // NOLINT
+  const auto        universe  = static_cast<std::uint32_t>(smallest * 20);  // NOLINT
+
+  // one small list and increasingly dense large ones, so the intersection is not empty
+  std::mt19937        rng(42); // NOLINT
+  std::vector<list_t> lists;
+  lists.push_back(make_list(rng, 0.05, universe)); // NOLINT
+  for (std::size_t i = 1; i < num_lists; ++i)
+    lists.push_back(make_list(rng, 1.0 - 0.5 / static_cast<double>(i), universe));
+
+  std::vector<const list_t*> ptrs;
+  for (const auto& l: lists) ptrs.push_back(&l);
+
+  std::size_t pairwise_count = 0;
+  {
+    os::bch::Timer t("pairwise intersect");
+    auto           acc = lists.front();
+    for (std::size_t i = 1; i != num_lists; ++i) acc = os::algo::set_intersection(acc, lists[i]);
+    pairwise_count = acc.size();
+  }
+  std::size_t nway_count = 0;
+  {
+    os::bch::Timer t("n-way intersect");
+    nway_count = os::algo::count_intersection(ptrs);
+  }
+  std::size_t pairwise_union = 0;
+  {
+    os::bch::Timer t("pairwise union");
+    auto           acc = lists.front();
+    for (std::size_t i = 1; i != num_lists; ++i) {
+      list_t next;
+      std::set_union(acc.begin(), acc.end(), lists[i].begin(), lists[i].end(),
+                     std::back_inserter(next));
+      acc = std::move(next);
+    }
+    pairwise_union = acc.size();
+  }
+  std::size_t nway_union = 0;
+  {
+    os::bch::Timer t("n-way union");
+    nway_union = os::algo::count_union(ptrs);
+  }
+
+  std::cout << "intersection: " << pairwise_count << " / " << nway_count << '\n'
+            << "union:        " << pairwise_union << " / " << nway_union << '\n';
+  return pairwise_count == nway_count && pairwise_union == nway_union ? 0 : 1;
+}
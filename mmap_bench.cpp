@@ -0,0 +1,61 @@
+// compares MemoryMappedFile access hints for one sequential pass over a large file, with a cold
+// page cache for each mode. The file is generated if missing or too small.
+// usage: mmap_bench [file] [size_mb]
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <string>
+
+#include "bench_files.hpp"
+#include "os/bch.hpp"
+#include "os/fs.hpp"
+
+std::size_t count_lines(const char* first, const char* last) {
+  std::size_t count = 0;
+  while (const void* nl = std::memchr(first, '\n', static_cast<std::size_t>(last - first))) {
+    ++count;
+    first = static_cast<const char*>(nl) + 1;
+  }
+  return count;
+}
+
+std::size_t run(const std::string& label, const std::string& filename,
+                const os::fs::map_options& options, bool window = false) {
+  drop_cache(filename);
+  os::bch::Timer           t(label);
+  os::fs::MemoryMappedFile mmf(filename, options);
+  if (!window) return count_lines(mmf.begin(), mmf.end());
+
+  // stream in 1 MB steps, advising ahead and dropping behind
+  constexpr std::size_t   step = 1UL << 20U;
+  os::fs::prefetch_window pw(mmf);
+  std::size_t             count = 0;
+  for (std::size_t offset = 0; offset < mmf.size(); offset += step) {
+    pw.advance(offset);
+    const std::size_t last = std::min(offset + step, mmf.size());
+    count += count_lines(mmf.begin() + offset, mmf.begin() + last); // NOLINT
+  }
+  pw.release(mmf.size());
+  return count;
+}
+
+int main(int argc, char* argv[]) {
+  const std::string filename = argc > 1 ? argv[1] : "mmap_bench.dat";
+  const std::size_t size_mb  = argc > 2 ? std::stoul(argv[2]) : 4096; // NOLINT
+  generate(filename, size_mb << 20U);
+
+  using os::fs::access;
+  const std::size_t expected = run("default", filename, {});
+  bool              ok       = true;
+  auto              check    = [&](std::size_t count) { ok = ok && count == expected; };
+  check(run("sequential", filename, {access::sequential}));
+  check(run("seq+willneed", filename, {access::sequential, true}));
+  check(run("populate", filename, {access::normal, false, true}));
+  check(run("huge pages", filename, {access::sequential, false, false, true}));
+  check(run("seq+window", filename, {access::sequential}, true));
+  check(run("random", filename, {access::random}));
+
+  std::cout << "lines: " << expected << (ok ? "" : "  MISMATCH") << '\n';
+  return ok ? 0 : 1;
+}
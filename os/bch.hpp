@@ -1,15 +1,47 @@
 #pragma once
 
+#include "os/string_builder.hpp"
+
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <utility>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <x86intrin.h>
+#define OS_PROF_RDTSC 1
+#else
+#define OS_PROF_RDTSC 0
+#endif
 
 namespace os::bch {
 // profiling
 
-using clk        = std::chrono::high_resolution_clock;
+// high_resolution_clock is system_clock in libstdc++, which can jump
+using clk        = std::chrono::steady_clock;
 using time_point = std::chrono::time_point<clk>;
 using std::chrono::duration;
 using std::chrono::duration_cast;
@@ -31,9 +63,11 @@ public:
     auto elapsed    = finish_ - start_;
     auto elapsed_s  = duration_cast<duration<double>>(elapsed).count();
     auto elapsed_ms = elapsed_s * 1000;
-    char buf[50]{0};                                                // NOLINT
-    std::sprintf(buf, "%-20s %12.4f ms", label.data(), elapsed_ms); // NOLINT
-    std::cerr << buf << '\n';                                       // NOLINT
+    os::str::string_builder ms;
+    ms.append_fixed(elapsed_ms, 4);
+    os::str::string_builder line;
+    line.rpad(label, 20).append(' ').lpad(ms.view(), 12).append(" ms\n");
+    std::cerr << line.view();
   }
 
 private:
@@ -42,4 +76,874 @@ private:
   std::string label;
 };
 
+// Stops the compiler from optimising away the computation of `value`, or stores to it.
+template <typename T>
+inline void do_not_optimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+  asm volatile("" : : "r,m"(value) : "memory"); // NOLINT
+#else
+  static_cast<void>(*static_cast<const volatile char*>(static_cast<const void*>(&value)));
+#endif
+}
+
+// Stops the compiler from assuming memory is unchanged (or unread) across this point.
+inline void clobber_memory() {
+#if defined(__GNUC__) || defined(__clang__)
+  asm volatile("" : : : "memory"); // NOLINT
+#endif
+}
+
+// Hardware counter totals, each -1 when that counter is unavailable.
+struct counter_values {
+  double cycles        = -1;
+  double instructions  = -1;
+  double cache_misses  = -1;
+  double branch_misses = -1;
+
+  [[nodiscard]] bool available() const {
+    return cycles >= 0 || instructions >= 0 || cache_misses >= 0 || branch_misses >= 0;
+  }
+
+  // instructions per cycle
+  [[nodiscard]] double ipc() const {
+    return cycles > 0 && instructions >= 0 ? instructions / cycles : -1;
+  }
+
+  // eg per call or per item
+  [[nodiscard]] counter_values per(double n) const {
+    auto scale = [n](double v) { return v >= 0 && n > 0 ? v / n : -1; };
+    return {scale(cycles), scale(instructions), scale(cache_misses), scale(branch_misses)};
+  }
+};
+
+// Counts cycles, instructions, cache misses and branch misses of the calling thread in user
+// space via perf_event_open(2). Each event is opened on its own, so the others still work when
+// one is missing, and counts are scaled up if the kernel had to multiplex them. When nothing can
+// be opened (not Linux, no PMU in a VM or container, kernel.perf_event_paranoid > 2) it is not
+// available() and stop() returns all -1: callers fall back to time only.
+class PerfCounters {
+public:
+  PerfCounters() {
+#ifdef __linux__
+    const std::uint64_t configs[events] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                           PERF_COUNT_HW_CACHE_MISSES,
+                                           PERF_COUNT_HW_BRANCH_MISSES};
+    for (std::size_t i = 0; i != events; ++i) {
+      perf_event_attr attr{};
+      attr.size           = sizeof(attr);
+      attr.type           = PERF_TYPE_HARDWARE;
+      attr.config         = configs[i]; // NOLINT
+      attr.disabled       = 1;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv     = 1;
+      attr.read_format    = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+      fds_[i] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0)); // NOLINT
+    }
+#endif
+  }
+
+  ~PerfCounters() {
+#ifdef __linux__
+    for (int fd: fds_)
+      if (fd != -1) close(fd);
+#endif
+  }
+
+  PerfCounters(const PerfCounters& other) = delete;
+  PerfCounters& operator=(const PerfCounters& other) = delete;
+  PerfCounters(PerfCounters&& other)                 = delete;
+  PerfCounters& operator=(PerfCounters&& other) = delete;
+
+  [[nodiscard]] bool available() const {
+    return std::any_of(std::begin(fds_), std::end(fds_), [](int fd) { return fd != -1; });
+  }
+
+  void start() {
+#ifdef __linux__
+    for (int fd: fds_) {
+      if (fd == -1) continue;
+      ioctl(fd, PERF_EVENT_IOC_RESET, 0);  // NOLINT
+      ioctl(fd, PERF_EVENT_IOC_ENABLE, 0); // NOLINT
+    }
+#endif
+  }
+
+  counter_values stop() {
+    double values[events] = {-1, -1, -1, -1};
+#ifdef __linux__
+    for (int fd: fds_)
+      if (fd != -1) ioctl(fd, PERF_EVENT_IOC_DISABLE, 0); // NOLINT
+    for (std::size_t i = 0; i != events; ++i) {
+      std::uint64_t data[3]{}; // value, time enabled, time running  NOLINT
+      if (fds_[i] == -1 || read(fds_[i], data, sizeof(data)) != sizeof(data) || data[2] == 0)
+        continue; // NOLINT
+      values[i] = static_cast<double>(data[0]) * static_cast<double>(data[1]) / // NOLINT
+                  static_cast<double>(data[2]);
+    }
+#endif
+    return {values[0], values[1], values[2], values[3]}; // NOLINT
+  }
+
+private:
+  static constexpr std::size_t events = 4;
+
+  int fds_[events] = {-1, -1, -1, -1}; // NOLINT
+};
+
+// Like Timer, and adds IPC and counts per item, if `items` is given, when counters are available.
+class PerfTimer {
+public:
+  explicit PerfTimer(std::string label, std::size_t items = 0)
+      : label_{std::move(label)}, items_{items} {
+    counters_.start();
+    start_ = clk::now();
+  }
+
+  ~PerfTimer() {
+    const auto elapsed = clk::now() - start_;
+    const auto values  = counters_.stop();
+    const auto ms      = duration_cast<duration<double, std::milli>>(elapsed).count();
+    char       buf[200]; // NOLINT
+    int        len = std::snprintf(buf, sizeof(buf), " %12.4f ms", ms); // NOLINT
+    if (values.available()) {
+      const auto per = values.per(items_ != 0 ? static_cast<double>(items_) : 1.0);
+      std::snprintf(buf + len, sizeof(buf) - static_cast<std::size_t>(len), // NOLINT
+                    "  IPC %.2f  per %s: %.1f cycles %.1f instr %.3f cache-miss %.3f br-miss",
+                    values.ipc(), items_ != 0 ? "item" : "run", per.cycles, per.instructions,
+                    per.cache_misses, per.branch_misses);
+    }
+    std::cerr << label_ << std::string(label_.size() < 20 ? 20 - label_.size() : 0, ' ') << buf
+              << '\n';
+  }
+
+  PerfTimer(const PerfTimer& other) = delete;
+  PerfTimer& operator=(const PerfTimer& other) = delete;
+  PerfTimer(PerfTimer&& other)                 = delete;
+  PerfTimer& operator=(PerfTimer&& other) = delete;
+
+private:
+  std::string  label_;
+  std::size_t  items_;
+  PerfCounters counters_;
+  time_point   start_;
+};
+
+struct bench_options {
+  duration<double> warmup      = duration<double>(0.1); // seconds of untimed runs per benchmark
+  duration<double> sample_time = duration<double>(0.01); // target length of one sample
+  std::size_t      samples     = 30;
+  bool             counters    = false; // hardware counters over all samples, if available
+};
+
+// work done by one call of the benchmarked function, for throughput
+struct bench_work {
+  std::size_t bytes = 0;
+  std::size_t items = 0;
+};
+
+// times per call, in nanoseconds. Throughput is based on the median.
+struct bench_result {
+  std::string    name;
+  std::size_t    iterations       = 0; // calls per sample
+  std::size_t    samples          = 0;
+  double         min              = 0;
+  double         median           = 0;
+  double         p99              = 0;
+  double         mean             = 0;
+  double         stddev           = 0;
+  double         bytes_per_second = 0;
+  double         items_per_second = 0;
+  counter_values counters; // per item, or per call when there are no items
+};
+
+// Runs a function in timed batches and keeps the statistics:
+//
+//   os::bch::Bench bench;
+//   bench.run("parse", [&] { os::bch::do_not_optimize(parse(buf)); }, {buf.size(), 1});
+//   bench.print_table();
+//   bench.print_json(std::cout); // to compare across commits
+//
+// Each run warms up, then grows the batch size until a batch takes about `sample_time`, and
+// records `samples` batches of that size. Sorting the per call times gives min, median and p99
+// which, unlike the mean, are robust to the odd interrupted sample. With `counters` set, IPC
+// and hardware counts per item are added where perf_event_open() is permitted.
+class Bench {
+public:
+  explicit Bench(bench_options options = {}) : options_{options} {}
+
+  template <typename Fn>
+  const bench_result& run(std::string name, Fn&& fn, bench_work work = {}) {
+    const auto warmup_end = clk::now() + duration_cast<clk::duration>(options_.warmup);
+    do {
+      fn();
+    } while (clk::now() < warmup_end);
+
+    // an empty body could otherwise never reach the sample time
+    constexpr std::size_t max_iterations = 1'000'000'000;
+    std::size_t           iterations     = 1;
+    while (true) {
+      const double elapsed = time_batch(fn, iterations);
+      if (elapsed >= options_.sample_time.count() || iterations >= max_iterations) break;
+      // aim a little past the target, but grow at most 10x per step to stay within budget
+      const double scale = elapsed > 0 ? 1.2 * options_.sample_time.count() / elapsed : 10.0;
+      iterations         = static_cast<std::size_t>(
+          std::min(static_cast<double>(max_iterations),
+                   static_cast<double>(iterations) * std::clamp(scale, 2.0, 10.0)));
+    }
+
+    std::vector<double> per_call(std::max<std::size_t>(options_.samples, 1));
+    if (options_.counters && !perf_) perf_ = std::make_unique<PerfCounters>();
+    if (perf_) perf_->start();
+    for (auto& t: per_call) t = time_batch(fn, iterations) * 1e9 / static_cast<double>(iterations);
+    const counter_values counts = perf_ ? perf_->stop() : counter_values{};
+    std::sort(per_call.begin(), per_call.end());
+
+    bench_result r;
+    r.name       = std::move(name);
+    r.iterations = iterations;
+    r.samples    = per_call.size();
+    r.min        = per_call.front();
+    r.median     = percentile(per_call, 0.5);
+    r.p99        = percentile(per_call, 0.99);
+    double sum   = 0;
+    for (double t: per_call) sum += t;
+    r.mean     = sum / static_cast<double>(per_call.size());
+    double var = 0;
+    for (double t: per_call) var += (t - r.mean) * (t - r.mean);
+    r.stddev = per_call.size() > 1 ? std::sqrt(var / static_cast<double>(per_call.size() - 1)) : 0;
+    if (r.median > 0) {
+      r.bytes_per_second = static_cast<double>(work.bytes) * 1e9 / r.median;
+      r.items_per_second = static_cast<double>(work.items) * 1e9 / r.median;
+    }
+    const double calls = static_cast<double>(iterations) * static_cast<double>(r.samples);
+    r.counters = counts.per(calls * static_cast<double>(std::max<std::size_t>(work.items, 1)));
+    results_.push_back(std::move(r));
+    return results_.back();
+  }
+
+  [[nodiscard]] const std::vector<bench_result>& results() const { return results_; }
+
+  void print_table(std::ostream& os = std::cerr) const {
+    std::size_t width    = 4;
+    bool        counters = false;
+    for (const auto& r: results_) {
+      width    = std::max(width, r.name.size());
+      counters = counters || r.counters.available();
+    }
+    os << pad("name", width) << pad_left("iterations", 12) << pad_left("min", 12)
+       << pad_left("median", 12) << pad_left("p99", 12) << pad_left("stddev", 12)
+       << pad_left("throughput", 14);
+    if (counters)
+      os << pad_left("IPC", 7) << pad_left("cycles", 11) << pad_left("instr", 11)
+         << pad_left("cache-miss", 11) << pad_left("br-miss", 11) << "  (per item)";
+    os << '\n';
+    for (const auto& r: results_) {
+      os << pad(r.name, width) << pad_left(std::to_string(r.iterations), 12)
+         << pad_left(format_time(r.min), 12) << pad_left(format_time(r.median), 12)
+         << pad_left(format_time(r.p99), 12) << pad_left(format_time(r.stddev), 12);
+      if (r.bytes_per_second > 0)
+        os << pad_left(format_rate(r.bytes_per_second, "B/s"), 14);
+      else if (r.items_per_second > 0)
+        os << pad_left(format_rate(r.items_per_second, "/s"), 14);
+      else if (counters)
+        os << pad_left("", 14);
+      if (counters) {
+        const auto& c = r.counters;
+        os << pad_left(format_count(c.ipc(), 2), 7) << pad_left(format_count(c.cycles, 1), 11)
+           << pad_left(format_count(c.instructions, 1), 11)
+           << pad_left(format_count(c.cache_misses, 3), 11)
+           << pad_left(format_count(c.branch_misses, 3), 11);
+      }
+      os << '\n';
+    }
+  }
+
+  // one object per result, times in ns
+  void print_json(std::ostream& os) const {
+    os << "[\n";
+    for (std::size_t i = 0; i != results_.size(); ++i) {
+      const auto& r = results_[i];
+      char        buf[400]; // NOLINT
+      std::snprintf(buf, sizeof(buf), // NOLINT
+                    "\"iterations\": %zu, \"samples\": %zu, \"min_ns\": %.3f, "
+                    "\"median_ns\": %.3f, \"p99_ns\": %.3f, \"mean_ns\": %.3f, "
+                    "\"stddev_ns\": %.3f, \"bytes_per_second\": %.6g, "
+                    "\"items_per_second\": %.6g",
+                    r.iterations, r.samples, r.min, r.median, r.p99, r.mean, r.stddev,
+                    r.bytes_per_second, r.items_per_second);
+      os << "  {\"name\": " << json_string(r.name) << ", " << buf;
+      const auto& c = r.counters;
+      if (c.available()) {
+        std::snprintf(buf, sizeof(buf), // NOLINT
+                      ", \"ipc\": %.4g, \"cycles\": %.6g, \"instructions\": %.6g, "
+                      "\"cache_misses\": %.6g, \"branch_misses\": %.6g",
+                      c.ipc(), c.cycles, c.instructions, c.cache_misses, c.branch_misses);
+        os << buf; // NOLINT
+      }
+      os << '}' << (i + 1 != results_.size() ? ",\n" : "\n");
+    }
+    os << "]\n";
+  }
+
+private:
+  // seconds for `iterations` calls
+  template <typename Fn>
+  static double time_batch(Fn& fn, std::size_t iterations) {
+    const auto start = clk::now();
+    for (std::size_t i = 0; i != iterations; ++i) fn();
+    clobber_memory();
+    return duration_cast<duration<double>>(clk::now() - start).count();
+  }
+
+  // nearest rank on sorted samples
+  static double percentile(const std::vector<double>& sorted, double p) {
+    const auto rank = static_cast<std::size_t>(std::ceil(p * static_cast<double>(sorted.size())));
+    return sorted[std::clamp<std::size_t>(rank, 1, sorted.size()) - 1];
+  }
+
+  static std::string format_time(double ns) {
+    char buf[32]; // NOLINT
+    if (ns < 1e3)
+      std::snprintf(buf, sizeof(buf), "%.2f ns", ns); // NOLINT
+    else if (ns < 1e6)
+      std::snprintf(buf, sizeof(buf), "%.2f us", ns / 1e3); // NOLINT
+    else if (ns < 1e9)
+      std::snprintf(buf, sizeof(buf), "%.2f ms", ns / 1e6); // NOLINT
+    else
+      std::snprintf(buf, sizeof(buf), "%.2f s", ns / 1e9); // NOLINT
+    return buf;                                          // NOLINT
+  }
+
+  static std::string format_rate(double per_second, const char* unit) {
+    const char* prefixes = " kMGTP";
+    while (per_second >= 1000 && prefixes[1] != '\0') {
+      per_second /= 1000;
+      ++prefixes; // NOLINT
+    }
+    char buf[32]; // NOLINT
+    if (*prefixes == ' ')
+      std::snprintf(buf, sizeof(buf), "%.2f %s", per_second, unit); // NOLINT
+    else
+      std::snprintf(buf, sizeof(buf), "%.2f %c%s", per_second, *prefixes, unit); // NOLINT
+    return buf;                                                                  // NOLINT
+  }
+
+  // "-" for unavailable counters
+  static std::string format_count(double v, int precision) {
+    if (v < 0) return "-";
+    char buf[32];                                          // NOLINT
+    std::snprintf(buf, sizeof(buf), "%.*f", precision, v); // NOLINT
+    return buf;                                            // NOLINT
+  }
+
+  static std::string pad(std::string_view s, std::size_t width) {
+    std::string r(s);
+    r.resize(std::max(width, s.size()) + 2, ' ');
+    return r;
+  }
+
+  static std::string pad_left(std::string_view s, std::size_t width) {
+    return std::string(width > s.size() ? width - s.size() : 0, ' ').append(s);
+  }
+
+  static std::string json_string(std::string_view s) {
+    std::string r = "\"";
+    for (char c: s) {
+      if (c == '"' || c == '\\') {
+        r += '\\';
+        r += c;
+      } else if (static_cast<unsigned char>(c) < 0x20) {
+        char buf[8]; // NOLINT
+        std::snprintf(buf, sizeof(buf), "\\u%04x", static_cast<unsigned>(c)); // NOLINT
+        r += buf;                                                             // NOLINT
+      } else {
+        r += c;
+      }
+    }
+    return r += '"';
+  }
+
+  bench_options                 options_;
+  std::vector<bench_result>     results_;
+  std::unique_ptr<PerfCounters> perf_;
+};
+
+// Log-linear histogram of non-negative integers, eg latencies in ns, in fixed memory. Values
+// below 256 are counted exactly. Above, each power of two is split into 128 buckets, so
+// percentiles are within 1/128 (0.8%) of the true value, over the whole uint64 range, in
+// 7424 counters.
+class Histogram {
+public:
+  static constexpr unsigned    sub_bucket_bits = 7;
+  static constexpr std::size_t sub_buckets     = std::size_t{1} << sub_bucket_bits;
+  static constexpr std::size_t buckets         = (64 - sub_bucket_bits + 1) * sub_buckets;
+
+  static std::size_t bucket_of(std::uint64_t value) {
+    if (value < sub_buckets) return static_cast<std::size_t>(value);
+    const unsigned high  = 63U - static_cast<unsigned>(__builtin_clzll(value));
+    const unsigned group = high - sub_bucket_bits + 1;
+    return group * sub_buckets + static_cast<std::size_t>(value >> (group - 1)) - sub_buckets;
+  }
+
+  // smallest and largest value counted in `bucket`
+  static std::uint64_t lowest_of(std::size_t bucket) {
+    const std::size_t group = bucket / sub_buckets;
+    const std::size_t sub   = bucket % sub_buckets;
+    if (group == 0) return sub;
+    return static_cast<std::uint64_t>(sub_buckets + sub) << (group - 1);
+  }
+
+  static std::uint64_t highest_of(std::size_t bucket) {
+    const std::size_t group = bucket / sub_buckets;
+    return lowest_of(bucket) + (group == 0 ? 0 : (std::uint64_t{1} << (group - 1)) - 1);
+  }
+
+  void record(std::uint64_t value, std::uint64_t n = 1) {
+    if (n == 0) return;
+    counts_[bucket_of(value)] += n;
+    min_ = std::min(min_, value);
+    max_ = std::max(max_, value);
+    count_ += n;
+    sum_ += static_cast<double>(value) * static_cast<double>(n);
+  }
+
+  void record(clk::duration elapsed) {
+    record(static_cast<std::uint64_t>(
+        std::max<std::int64_t>(0, duration_cast<std::chrono::nanoseconds>(elapsed).count())));
+  }
+
+  void merge(const Histogram& other) {
+    for (std::size_t i = 0; i != buckets; ++i) counts_[i] += other.counts_[i];
+    if (other.count_ == 0) return;
+    min_ = std::min(min_, other.min_);
+    max_ = std::max(max_, other.max_);
+    count_ += other.count_;
+    sum_ += other.sum_;
+  }
+
+  void reset() { *this = Histogram{}; }
+
+  [[nodiscard]] std::uint64_t count() const { return count_; }
+  [[nodiscard]] std::uint64_t min() const { return count_ != 0 ? std::min(min_, max_) : 0; }
+  [[nodiscard]] std::uint64_t max() const { return max_; }
+  [[nodiscard]] double        mean() const {
+    return count_ != 0 ? sum_ / static_cast<double>(count_) : 0;
+  }
+  [[nodiscard]] std::uint64_t count_at(std::size_t bucket) const { return counts_[bucket]; }
+
+  // The value below or at which `p` (0..1) of the recorded values lie: the highest value of
+  // the bucket holding that rank, capped at max().
+  [[nodiscard]] std::uint64_t percentile(double p) const {
+    if (count_ == 0) return 0;
+    const auto rank = std::clamp<std::uint64_t>(
+        static_cast<std::uint64_t>(std::ceil(p * static_cast<double>(count_))), 1, count_);
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i != buckets; ++i) {
+      seen += counts_[i];
+      if (seen >= rank) return std::min(std::max(highest_of(i), min_), max_);
+    }
+    return max_;
+  }
+
+  void print(std::ostream& os = std::cerr) const {
+    char buf[200]; // NOLINT
+    std::snprintf(buf, sizeof(buf), // NOLINT
+                  "count %llu  min %llu  p50 %llu  p90 %llu  p99 %llu  p99.9 %llu  max %llu  "
+                  "mean %.1f",
+                  static_cast<unsigned long long>(count_), static_cast<unsigned long long>(min()),
+                  static_cast<unsigned long long>(percentile(0.5)),
+                  static_cast<unsigned long long>(percentile(0.9)),
+                  static_cast<unsigned long long>(percentile(0.99)),
+                  static_cast<unsigned long long>(percentile(0.999)),
+                  static_cast<unsigned long long>(max_), mean());
+    os << buf << '\n'; // NOLINT
+  }
+
+  // One line of text, eg "hist1 3 5 9 21 5:2 4:1": count, min, max, sum, then the non zero
+  // buckets as "gap from the previous bucket:count". At most a few kB, even for values spread
+  // over many orders of magnitude, and platform independent, so snapshots can be stored and
+  // compared offline.
+  [[nodiscard]] std::string serialize() const {
+    char buf[100]; // NOLINT
+    std::snprintf(buf, sizeof(buf), "hist1 %llu %llu %llu %.17g", // NOLINT
+                  static_cast<unsigned long long>(count_), static_cast<unsigned long long>(min()),
+                  static_cast<unsigned long long>(max_), sum_);
+    std::string out = buf; // NOLINT
+    std::size_t last = 0;
+    for (std::size_t i = 0; i != buckets; ++i) {
+      if (counts_[i] == 0) continue;
+      out += ' ';
+      out += std::to_string(i - last);
+      out += ':';
+      out += std::to_string(counts_[i]);
+      last = i;
+    }
+    return out;
+  }
+
+  static Histogram deserialize(std::string_view text) {
+    std::istringstream is{std::string(text)};
+    std::string        magic;
+    Histogram          h;
+    is >> magic >> h.count_ >> h.min_ >> h.max_ >> h.sum_;
+    if (!is || magic != "hist1") throw std::domain_error("Histogram: bad header");
+    std::size_t   bucket = 0;
+    std::size_t   gap    = 0;
+    char          colon  = 0;
+    std::uint64_t n      = 0;
+    std::uint64_t total  = 0;
+    while (is >> gap >> colon >> n) {
+      bucket += gap;
+      if (colon != ':' || bucket >= buckets) throw std::domain_error("Histogram: bad bucket");
+      h.counts_[bucket] = n;
+      total += n;
+    }
+    if (!is.eof() || total != h.count_) throw std::domain_error("Histogram: bad counts");
+    if (h.count_ == 0) h.min_ = ~std::uint64_t{0};
+    return h;
+  }
+
+private:
+  friend class LatencyRecorder;
+
+  std::vector<std::uint64_t> counts_ = std::vector<std::uint64_t>(buckets);
+  std::uint64_t              count_  = 0;
+  std::uint64_t              min_    = ~std::uint64_t{0};
+  std::uint64_t              max_    = 0;
+  double                     sum_    = 0;
+};
+
+// Records into a Histogram from many threads without locks or shared cache lines: each thread
+// gets its own shard on first use, which only it writes (with relaxed atomic stores, so that
+// snapshot() can read it concurrently). Shards live as long as the recorder, so the counts of
+// finished threads are kept.
+class LatencyRecorder {
+public:
+  LatencyRecorder() : id_{next_id()} {}
+
+  LatencyRecorder(const LatencyRecorder& other) = delete;
+  LatencyRecorder& operator=(const LatencyRecorder& other) = delete;
+  LatencyRecorder(LatencyRecorder&& other)                 = delete;
+  LatencyRecorder& operator=(LatencyRecorder&& other) = delete;
+
+  void record(std::uint64_t value) {
+    shard& s = local_shard();
+    if (value < s.min.load(std::memory_order_relaxed))
+      s.min.store(value, std::memory_order_relaxed);
+    if (value > s.max.load(std::memory_order_relaxed))
+      s.max.store(value, std::memory_order_relaxed);
+    bump(s.sum, value);
+    bump(s.counts[Histogram::bucket_of(value)], 1);
+  }
+
+  void record(clk::duration elapsed) {
+    record(static_cast<std::uint64_t>(
+        std::max<std::int64_t>(0, duration_cast<std::chrono::nanoseconds>(elapsed).count())));
+  }
+
+  // all threads merged, while they keep recording
+  [[nodiscard]] Histogram snapshot() const {
+    Histogram       h;
+    std::lock_guard lock(mutex_);
+    for (const auto& s: shards_) {
+      std::uint64_t total = 0;
+      for (std::size_t i = 0; i != Histogram::buckets; ++i) {
+        const std::uint64_t n = s->counts[i].load(std::memory_order_relaxed);
+        h.counts_[i] += n;
+        total += n;
+      }
+      if (total == 0) continue;
+      h.count_ += total;
+      h.sum_ += static_cast<double>(s->sum.load(std::memory_order_relaxed));
+      h.min_ = std::min(h.min_, s->min.load(std::memory_order_relaxed));
+      h.max_ = std::max(h.max_, s->max.load(std::memory_order_relaxed));
+    }
+    return h;
+  }
+
+private:
+  struct shard {
+    std::atomic<std::uint64_t> counts[Histogram::buckets]{}; // NOLINT
+    std::atomic<std::uint64_t> sum{0};
+    std::atomic<std::uint64_t> min{~std::uint64_t{0}};
+    std::atomic<std::uint64_t> max{0};
+  };
+
+  // single writer, so no read-modify-write needed
+  static void bump(std::atomic<std::uint64_t>& a, std::uint64_t n) {
+    a.store(a.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+  }
+
+  static std::uint64_t next_id() {
+    static std::atomic<std::uint64_t> id{0};
+    return ++id;
+  }
+
+  // ids, unlike addresses, are never reused by a later recorder
+  shard& local_shard() {
+    thread_local std::vector<std::pair<std::uint64_t, shard*>> cache;
+    for (const auto& [id, s]: cache)
+      if (id == id_) return *s;
+    std::lock_guard lock(mutex_);
+    shards_.push_back(std::make_unique<shard>());
+    cache.emplace_back(id_, shards_.back().get());
+    return *shards_.back();
+  }
+
+  std::uint64_t                       id_;
+  mutable std::mutex                  mutex_;
+  std::vector<std::unique_ptr<shard>> shards_;
+};
+
+// Hierarchical profiling zones, cheap enough to leave in production binaries:
+//
+//   void parse(...) {
+//     OS_PROF_ZONE("parse");
+//     for (...) {
+//       OS_PROF_ZONE("field"); // nested under "parse" in the report
+//       ...
+//
+// Zones are off unless the environment has OS_PROF=1 or prof::enable(true) is called, and then
+// cost one relaxed load. When on, each thread adds its timings into its own call tree, keyed by
+// the zone's name pointer, so recording takes no locks and memory does not grow with the number
+// of calls. prof::report() merges the trees of all threads by name; it runs at exit when enabled
+// and can be called on request while profiled threads are idle. Timestamps come from rdtsc,
+// assumed invariant as on all recent x86, and are converted to time by calibrating against
+// steady_clock. Define OS_NO_PROF to compile zones out completely.
+#ifdef OS_NO_PROF
+#define OS_PROF_ZONE(name) static_cast<void>(0)
+#else
+#define OS_PROF_CAT_IMPL(a, b) a##b
+#define OS_PROF_CAT(a, b)      OS_PROF_CAT_IMPL(a, b)
+#define OS_PROF_ZONE(name)     const os::bch::prof::Zone OS_PROF_CAT(os_prof_zone_, __LINE__){name}
+#endif
+
+namespace prof {
+
+inline std::atomic<bool>& enabled_flag() {
+  static std::atomic<bool> flag{[] {
+    const char* env = std::getenv("OS_PROF"); // NOLINT not thread safe, read once
+    return env != nullptr && std::strcmp(env, "0") != 0 && *env != '\0';
+  }()};
+  return flag;
+}
+
+inline bool enabled() { return enabled_flag().load(std::memory_order_relaxed); }
+inline void enable(bool on = true) { enabled_flag().store(on, std::memory_order_relaxed); }
+
+inline std::uint64_t ticks() {
+#if OS_PROF_RDTSC
+  return __rdtsc();
+#else
+  return static_cast<std::uint64_t>(clk::now().time_since_epoch().count());
+#endif
+}
+
+namespace detail {
+
+constexpr std::uint32_t none = ~std::uint32_t{0};
+
+// nodes[0] is the root, children are a linked list through next_sibling
+struct node {
+  const char*   name;
+  std::uint32_t parent;
+  std::uint32_t first_child  = none;
+  std::uint32_t next_sibling = none;
+  std::uint64_t count        = 0;
+  std::uint64_t ticks        = 0;
+};
+
+using tree = std::vector<node>;
+
+class registry;
+registry& get_registry();
+
+// one per thread, only ever touched by its thread until report()
+class thread_log {
+public:
+  thread_log();
+  ~thread_log();
+
+  thread_log(const thread_log& other) = delete;
+  thread_log& operator=(const thread_log& other) = delete;
+  thread_log(thread_log&& other)                 = delete;
+  thread_log& operator=(thread_log&& other) = delete;
+
+  static thread_log& local() {
+    static thread_local thread_log log;
+    return log;
+  }
+
+  std::uint32_t enter(const char* name) {
+    std::uint32_t child = nodes_[current_].first_child;
+    while (child != none && nodes_[child].name != name) child = nodes_[child].next_sibling;
+    if (child == none) {
+      child = static_cast<std::uint32_t>(nodes_.size());
+      nodes_.push_back({name, current_, none, nodes_[current_].first_child});
+      nodes_[current_].first_child = child;
+    }
+    current_ = child;
+    return child;
+  }
+
+  void leave(std::uint32_t n, std::uint64_t elapsed) {
+    ++nodes_[n].count;
+    nodes_[n].ticks += elapsed;
+    current_ = nodes_[n].parent;
+  }
+
+  [[nodiscard]] const tree& nodes() const { return nodes_; }
+
+private:
+  tree          nodes_{node{"", none}};
+  std::uint32_t current_ = 0;
+};
+
+// a zone name with the sum over all threads, children ordered by total time
+struct merged {
+  std::string         name;
+  std::uint64_t       count = 0;
+  std::uint64_t       ticks = 0;
+  std::vector<merged> children;
+};
+
+inline void merge(merged& into, const tree& nodes, std::uint32_t n) {
+  for (std::uint32_t c = nodes[n].first_child; c != none; c = nodes[c].next_sibling) {
+    auto it = std::find_if(into.children.begin(), into.children.end(),
+                           [&](const merged& m) { return m.name == nodes[c].name; });
+    if (it == into.children.end()) it = into.children.insert(it, merged{nodes[c].name, 0, 0, {}});
+    it->count += nodes[c].count;
+    it->ticks += nodes[c].ticks;
+    merge(*it, nodes, c);
+  }
+}
+
+inline void print(std::ostream& os, const merged& m, std::size_t depth, double ns_per_tick) {
+  std::uint64_t child_ticks = 0;
+  for (const auto& c: m.children) child_ticks += c.ticks;
+  const double total_ms = static_cast<double>(m.ticks) * ns_per_tick / 1e6;
+  const double self_ms  = static_cast<double>(m.ticks - std::min(m.ticks, child_ticks)) *
+                         ns_per_tick / 1e6;
+  const double mean_us = m.count != 0 ? total_ms * 1e3 / static_cast<double>(m.count) : 0;
+
+  std::string label = std::string(2 * depth, ' ') + m.name;
+  if (label.size() < 32) label.resize(32, ' ');
+  char buf[80]; // NOLINT
+  std::snprintf(buf, sizeof(buf), " %12llu %12.3f %12.3f %12.3f", // NOLINT
+                static_cast<unsigned long long>(m.count), total_ms, self_ms, mean_us);
+  os << label << buf << '\n';
+
+  auto children = m.children;
+  std::sort(children.begin(), children.end(),
+            [](const merged& a, const merged& b) { return a.ticks > b.ticks; });
+  for (const auto& c: children) print(os, c, depth + 1, ns_per_tick);
+}
+
+class registry {
+public:
+  registry() : start_ticks_{ticks()}, start_time_{clk::now()} {}
+
+  // the end of the program: report if anything was recorded
+  ~registry() {
+    if (enabled()) report(std::cerr);
+  }
+
+  registry(const registry& other) = delete;
+  registry& operator=(const registry& other) = delete;
+  registry(registry&& other)                 = delete;
+  registry& operator=(registry&& other) = delete;
+
+  void add(const thread_log* log) {
+    std::lock_guard lock(mutex_);
+    live_.push_back(log);
+  }
+
+  // keep the results of threads which have finished
+  void retire(const thread_log* log) {
+    std::lock_guard lock(mutex_);
+    live_.erase(std::remove(live_.begin(), live_.end(), log), live_.end());
+    if (log->nodes().size() > 1) retired_.push_back(log->nodes());
+  }
+
+  void report(std::ostream& os) {
+    merged root;
+    {
+      std::lock_guard lock(mutex_);
+      for (const auto* log: live_) merge(root, log->nodes(), 0);
+      for (const auto& t: retired_) merge(root, t, 0);
+    }
+    if (root.children.empty()) return;
+
+    char buf[80]; // NOLINT
+    std::snprintf(buf, sizeof(buf), " %12s %12s %12s %12s", "count", "total ms", // NOLINT
+                  "self ms", "mean us");
+    os << std::string("zone").append(28, ' ') << buf << '\n';
+    const double ns_per_tick = calibrate();
+    std::sort(root.children.begin(), root.children.end(),
+              [](const merged& a, const merged& b) { return a.ticks > b.ticks; });
+    for (const auto& c: root.children) print(os, c, 0, ns_per_tick);
+  }
+
+private:
+  // ticks since construction against steady_clock, over at least 10ms
+  [[nodiscard]] double calibrate() const {
+#if OS_PROF_RDTSC
+    while (clk::now() - start_time_ < std::chrono::milliseconds(10))
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    const auto   elapsed_ticks = ticks() - start_ticks_;
+    const double elapsed_ns = duration_cast<duration<double, std::nano>>(clk::now() - start_time_)
+                                  .count();
+    return elapsed_ticks != 0 ? elapsed_ns / static_cast<double>(elapsed_ticks) : 0;
+#else
+    return duration_cast<duration<double, std::nano>>(clk::duration{1}).count();
+#endif
+  }
+
+  std::mutex                     mutex_;
+  std::vector<const thread_log*> live_;
+  std::vector<tree>              retired_;
+  std::uint64_t                  start_ticks_;
+  time_point                     start_time_;
+};
+
+inline registry& get_registry() {
+  static registry r;
+  return r;
+}
+
+inline thread_log::thread_log() { get_registry().add(this); }
+inline thread_log::~thread_log() { get_registry().retire(this); }
+
+} // namespace detail
+
+// Times the enclosing scope under `name`, which must outlive the report, eg a string literal.
+class Zone {
+public:
+  explicit Zone(const char* name) {
+    if (!enabled()) return;
+    log_   = &detail::thread_log::local();
+    node_  = log_->enter(name);
+    start_ = ticks();
+  }
+
+  ~Zone() {
+    if (log_ != nullptr) log_->leave(node_, ticks() - start_);
+  }
+
+  Zone(const Zone& other) = delete;
+  Zone& operator=(const Zone& other) = delete;
+  Zone(Zone&& other)                 = delete;
+  Zone& operator=(Zone&& other) = delete;
+
+private:
+  detail::thread_log* log_   = nullptr;
+  std::uint32_t       node_  = detail::none;
+  std::uint64_t       start_ = 0;
+};
+
+// count, total, self (total less nested zones) and mean time per zone, merged over all threads
+inline void report(std::ostream& os = std::cerr) { detail::get_registry().report(os); }
+
+} // namespace prof
+
 } // namespace os::bch
@@ -1,8 +1,12 @@
 #pragma once
 
+#include "os/simd.hpp"
 #include "os/str.hpp"
 
+#include <cerrno>
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <iomanip>
 #include <iostream>
 #include <list>
@@ -12,6 +16,8 @@
 #include <unordered_set>
 #include <vector>
 
+#include <unistd.h>
+
 namespace os {
 
 // utility: keeps states of an ostream, restores on destruction
@@ -38,69 +44,170 @@ private:
 };
 
 namespace detail {
-inline void print_adr(std::ostream& os, const std::byte* adr) {
-  os << std::setw(19) << std::setfill(' ') << adr; // NOLINT
-}
 
-inline void print_fill_advance(std::ostream& os, const std::byte*& buf, std::size_t cnt,
-                               const std::string& str) {
-  while (cnt-- != 0U) {
-    ++buf; // NOTE: unusually this in passsed in by ref and we advance it. NOLINT
-    os << str;
+// hex_dump builds whole lines in a stack buffer and writes them in blocks:
+//   "     0x7ffc5999e2a0: 78 56 34 12 -- -- ... -- --  | xV4............."
+// The address is right aligned in 19 columns, bytes outside the buffer show as "--" and ".".
+constexpr std::size_t hd_linesize   = 16;
+constexpr std::size_t hd_linechars  = 19 + 2 + 3 * hd_linesize + 3 + hd_linesize + 1;
+constexpr std::size_t hd_blocklines = 64;
+
+inline constexpr char hd_digits[2][17] = {"0123456789abcdef", "0123456789ABCDEF"};
+
+// as `os << static_cast<const void*>(adr)` does: lower case, with 0x unless 0
+inline char* hd_format_adr(char* out, const std::byte* adr) {
+  auto        value = reinterpret_cast<std::uintptr_t>(adr); // NOLINT
+  char        digits[19];                                    // NOLINT
+  std::size_t n = 0;
+  do {
+    digits[sizeof(digits) - ++n] = hd_digits[0][value & 0xfU]; // NOLINT
+    value >>= 4U;
+  } while (value != 0);
+  if (adr != nullptr) {
+    digits[sizeof(digits) - ++n] = 'x'; // NOLINT
+    digits[sizeof(digits) - ++n] = '0'; // NOLINT
   }
+  std::memset(out, ' ', 19 - n);                             // NOLINT
+  std::memcpy(out + 19 - n, digits + sizeof(digits) - n, n); // NOLINT
+  std::memcpy(out + 19, ": ", 2);                            // NOLINT
+  return out + 21;                                           // NOLINT
 }
 
-inline void print_hex(std::ostream& os, const std::byte* buf, std::size_t linesize, std::size_t pre,
-                      std::size_t post) {
-  print_fill_advance(os, buf, pre, "-- ");
-  {
-    os << std::setfill('0') << std::hex;
-    auto cnt = linesize - pre - post;
-    while (cnt-- != 0U) os << std::setw(2) << static_cast<unsigned>(*buf++) << ' '; // NOLINT
+inline bool hd_printable(unsigned char c) { return c >= 0x20 && c < 0x7f; } // isprint in "C"
+
+// the hex and ascii columns, `pre` and `post` bytes of the line are not part of the buffer
+inline char* hd_format_bytes(char* out, const std::byte* line, std::size_t pre, std::size_t post,
+                             bool upper) {
+  const char* digits = hd_digits[upper ? 1 : 0];  // NOLINT
+  char*       ascii  = out + 3 * hd_linesize + 3; // NOLINT
+  for (std::size_t i = 0; i != hd_linesize; ++i) {
+    if (i < pre || i >= hd_linesize - post) {
+      std::memcpy(out + 3 * i, "-- ", 3); // NOLINT
+      ascii[i] = '.';                     // NOLINT
+      continue;
+    }
+    const auto c   = static_cast<unsigned char>(line[i]);          // NOLINT
+    out[3 * i]     = digits[c >> 4U];                              // NOLINT
+    out[3 * i + 1] = digits[c & 0xfU];                             // NOLINT
+    out[3 * i + 2] = ' ';                                          // NOLINT
+    ascii[i]       = hd_printable(c) ? static_cast<char>(c) : '.'; // NOLINT
   }
-  print_fill_advance(os, buf, post, "-- ");
+  std::memcpy(out + 3 * hd_linesize, " | ", 3); // NOLINT
+  return ascii + hd_linesize;                   // NOLINT
 }
 
-inline void print_ascii(std::ostream& os, const std::byte* buf, std::size_t linesize,
-                        std::size_t pre, std::size_t post) {
-  print_fill_advance(os, buf, pre, ".");
-  auto cnt = linesize - pre - post;
-  while (cnt-- != 0U) {
-    os << (std::isprint(static_cast<unsigned char>(*buf)) != 0 ? static_cast<char>(*buf) : '.');
-    ++buf; // NOLINT
-  }
-  print_fill_advance(os, buf, post, ".");
+#if OS_SIMD_X86
+// a full line: pshufb looks up the digits and spreads them into "xx " triplets
+OS_TARGET_SSE42 inline char* hd_format_bytes_sse42(char* out, const std::byte* line, bool upper) {
+  const __m128i bytes  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(line)); // NOLINT
+  const __m128i digits = _mm_loadu_si128(reinterpret_cast<const __m128i*>(       // NOLINT
+      hd_digits[upper ? 1 : 0]));
+  const __m128i nib    = _mm_set1_epi8(0x0f);
+  const __m128i hi     = _mm_shuffle_epi8(digits, _mm_and_si128(_mm_srli_epi16(bytes, 4), nib));
+  const __m128i lo     = _mm_shuffle_epi8(digits, _mm_and_si128(bytes, nib));
+  const __m128i first  = _mm_unpacklo_epi8(hi, lo); // digits of bytes 0..7
+  const __m128i second = _mm_unpackhi_epi8(hi, lo); // digits of bytes 8..15
+
+  // pshufb writes 0 for an index of -128, and the spaces are or-ed in there
+  const __m128i s0 = _mm_setr_epi8(0, 0, 32, 0, 0, 32, 0, 0, 32, 0, 0, 32, 0, 0, 32, 0);
+  const __m128i s1 = _mm_setr_epi8(0, 32, 0, 0, 32, 0, 0, 32, 0, 0, 32, 0, 0, 32, 0, 0);
+  const __m128i s2 = _mm_setr_epi8(32, 0, 0, 32, 0, 0, 32, 0, 0, 32, 0, 0, 32, 0, 0, 32);
+  const __m128i out0 = _mm_or_si128(
+      _mm_shuffle_epi8(first, _mm_setr_epi8(0, 1, -128, 2, 3, -128, 4, 5, -128, 6, 7, -128, 8, 9,
+                                            -128, 10)),
+      s0);
+  const __m128i out1 = _mm_or_si128(
+      _mm_or_si128(_mm_shuffle_epi8(first, _mm_setr_epi8(11, -128, 12, 13, -128, 14, 15, -128, -128,
+                                                         -128, -128, -128, -128, -128, -128, -128)),
+                   _mm_shuffle_epi8(second, _mm_setr_epi8(-128, -128, -128, -128, -128, -128, -128,
+                                                          -128, 0, 1, -128, 2, 3, -128, 4, 5))),
+      s1);
+  const __m128i out2 = _mm_or_si128(
+      _mm_shuffle_epi8(second, _mm_setr_epi8(-128, 6, 7, -128, 8, 9, -128, 10, 11, -128, 12, 13,
+                                             -128, 14, 15, -128)),
+      s2);
+
+  // printable is 0x20..0x7e, signed compares also reject 0x80..0xff
+  const __m128i printable = _mm_and_si128(_mm_cmpgt_epi8(bytes, _mm_set1_epi8(0x1f)),
+                                          _mm_cmplt_epi8(bytes, _mm_set1_epi8(0x7f)));
+  const __m128i ascii     = _mm_blendv_epi8(_mm_set1_epi8('.'), bytes, printable);
+
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(out), out0);       // NOLINT
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 16), out1);  // NOLINT
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 32), out2);  // NOLINT
+  std::memcpy(out + 48, " | ", 3);                               // NOLINT
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 51), ascii); // NOLINT
+  return out + 67;                                               // NOLINT
 }
-} // namespace detail
+#endif
 
-inline std::ostream& hex_dump(std::ostream& os, const std::byte* buffer, std::size_t bufsize) {
-  if (buffer == nullptr || bufsize == 0) return os;
+// Calls write(const char*, std::size_t) with blocks of whole lines.
+template <typename Write>
+void hex_dump_lines(const std::byte* buffer, std::size_t bufsize, bool upper, Write&& write) {
+  if (buffer == nullptr || bufsize == 0) return;
 
-  constexpr std::size_t linesize{16};
-  const std::byte*      buf{buffer};
-  std::size_t           pre =
-      reinterpret_cast<std::size_t>(buffer) % linesize; // Size of pre-buffer area  NOLINT
+  std::size_t      pre = reinterpret_cast<std::uintptr_t>(buffer) % hd_linesize; // NOLINT
+  const std::byte* buf = buffer - pre;                                          // NOLINT
   bufsize += pre;
-  buf -= pre; // NOLINT
 
-  auto state = ostream_state{os}; // save stream setting and restore at end of scope
+#if OS_SIMD_X86
+  const bool sse42 = simd::level() >= simd::isa::sse42;
+#endif
+  char  block[hd_blocklines * hd_linechars]; // NOLINT
+  char* out = block;
   while (bufsize != 0U) {
-    std::size_t post = bufsize < linesize ? linesize - bufsize : 0;
-
-    detail::print_adr(os, buf);
-    os << ": ";
-    detail::print_hex(os, buf, linesize, pre, post);
-    os << " | ";
-    detail::print_ascii(os, buf, linesize, pre, post);
-    os << "\n";
+    const std::size_t post = bufsize < hd_linesize ? hd_linesize - bufsize : 0;
 
-    buf += linesize; // NOLINT
-    bufsize -= linesize - post;
+    out = hd_format_adr(out, buf);
+#if OS_SIMD_X86
+    if (sse42 && pre == 0 && post == 0)
+      out = hd_format_bytes_sse42(out, buf, upper);
+    else
+#endif
+      out = hd_format_bytes(out, buf, pre, post, upper);
+    *out++ = '\n'; // NOLINT
+
+    if (out == block + sizeof(block)) { // NOLINT
+      write(block, sizeof(block));
+      out = block;
+    }
+    buf += hd_linesize; // NOLINT
+    bufsize -= hd_linesize - post;
     pre = 0;
   }
+  if (out != block) write(block, static_cast<std::size_t>(out - block));
+}
+
+} // namespace detail
+
+// Lines of 16 bytes as address, hex and ascii. Lines are aligned to 16 byte addresses, the bytes
+// before and after the buffer show as "--". std::uppercase on `os` gives upper case hex digits.
+inline std::ostream& hex_dump(std::ostream& os, const std::byte* buffer, std::size_t bufsize) {
+  const bool upper = (os.flags() & std::ios_base::uppercase) != 0;
+  detail::hex_dump_lines(buffer, bufsize, upper, [&](const char* data, std::size_t size) {
+    os.write(data, static_cast<std::streamsize>(size));
+  });
   return os;
 }
 
+// the same, straight to a file descriptor, eg STDERR_FILENO. Returns false on write errors.
+inline bool hex_dump(int fd, const std::byte* buffer, std::size_t bufsize, bool upper = false) {
+  bool ok = true;
+  detail::hex_dump_lines(buffer, bufsize, upper, [&](const char* data, std::size_t size) {
+    while (ok && size != 0) {
+      const ssize_t n = ::write(fd, data, size);
+      if (n == -1 && errno == EINTR) continue;
+      if (n <= 0) {
+        ok = false;
+        break;
+      }
+      data += n; // NOLINT
+      size -= static_cast<std::size_t>(n);
+    }
+  });
+  return ok;
+}
+
 class hd {
 public:
   hd(const void* buf, std::size_t bufsz)
@@ -1,12 +1,37 @@
+#pragma once
+
+#include "os/algo.hpp"
+
 // for mmap:
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdlib>
 #include <fcntl.h>
+#include <cstring>
 #include <iostream>
+#include <iterator>
+#include <memory>
+#include <mutex>
 #include <stdexcept>
+#include <string>
 #include <string_view>
+#include <utility>
 #include <sys/mman.h>
 #include <sys/stat.h>
+#include <unistd.h>
 #include <fstream>
 #include <ext/stdio_filebuf.h>
+#include <thread>
+#include <vector>
+// for FileWriter:
+#include <array>
+#include <charconv>
+#include <climits>
+#include <ostream>
+#include <streambuf>
+#include <sys/uio.h>
+#include <type_traits>
 
 namespace os::fs {
 
@@ -24,34 +49,177 @@ inline FILE* cfile(buffer_t* const fb) {
 inline FILE* cfile(std::ofstream const& ofs) { return impl::cfile(ofs.rdbuf()); }
 inline FILE* cfile(std::ifstream const& ifs) { return impl::cfile(ifs.rdbuf()); }
 
+// Forward range over the lines of a buffer, as string_views without the '\n' (or "\r\n").
+// A last line without a trailing newline is included; an empty buffer has no lines.
+// Newlines are found with memchr, which glibc vectorises.
+class line_view {
+public:
+  class iterator {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type        = std::string_view;
+    using difference_type   = std::ptrdiff_t;
+    using pointer           = const std::string_view*;
+    using reference         = const std::string_view&;
+
+    iterator() = default;
+
+    reference operator*() const { return line_; }
+    pointer   operator->() const { return &line_; }
+
+    iterator& operator++() {
+      read_line(next_);
+      return *this;
+    }
+
+    iterator operator++(int) {
+      iterator old = *this;
+      ++*this;
+      return old;
+    }
+
+    bool operator==(const iterator& other) const { return line_.data() == other.line_.data(); }
+    bool operator!=(const iterator& other) const { return !(*this == other); }
+
+  private:
+    friend class line_view;
+
+    iterator(const char* pos, const char* end) : end_{end} { read_line(pos); }
+
+    void read_line(const char* pos) {
+      if (pos == end_) {
+        line_ = std::string_view{end_, 0}; // equal to end()
+        return;
+      }
+      const auto* nl = static_cast<const char*>(
+          std::memchr(pos, '\n', static_cast<std::size_t>(end_ - pos)));
+      const char* last = nl != nullptr ? nl : end_;
+      next_            = nl != nullptr ? nl + 1 : end_; // NOLINT
+      if (last != pos && last[-1] == '\r') --last;      // NOLINT
+      line_ = std::string_view{pos, static_cast<std::size_t>(last - pos)};
+    }
+
+    std::string_view line_;
+    const char*      next_ = nullptr;
+    const char*      end_  = nullptr;
+  };
+
+  explicit line_view(std::string_view buffer) : buffer_{buffer} {}
+
+  [[nodiscard]] iterator begin() const { return {buffer_.data(), end_ptr()}; }
+  [[nodiscard]] iterator end() const { return {end_ptr(), end_ptr()}; }
+
+private:
+  [[nodiscard]] const char* end_ptr() const { return buffer_.data() + buffer_.size(); } // NOLINT
+
+  std::string_view buffer_;
+};
+
+inline line_view lines(std::string_view buffer) { return line_view{buffer}; }
+
+// Splits `buffer` into `chunks` pieces of about equal size. Each piece ends just after a '\n'
+// (or at the end of the buffer), so no record spans two chunks. Fewer pieces are returned when
+// records are long compared to the chunk size.
+inline std::vector<std::string_view> split_chunks(std::string_view buffer, std::size_t chunks) {
+  std::vector<std::string_view> result;
+  if (buffer.empty()) return result;
+  chunks                   = std::max<std::size_t>(1, chunks);
+  const std::size_t target = buffer.size() / chunks + 1;
+  std::size_t       start  = 0;
+  while (start != buffer.size()) {
+    std::size_t end = std::min(start + target, buffer.size());
+    if (end != buffer.size()) {
+      end = buffer.find('\n', end - 1);
+      end = end == std::string_view::npos ? buffer.size() : end + 1;
+    }
+    result.push_back(buffer.substr(start, end - start));
+    start = end;
+  }
+  return result;
+}
+
+// Runs callback(chunk_index, chunk) on `threads` threads (0 => all cores) for the record
+// aligned chunks of `buffer`. By default there are 4 chunks per thread to even out the load.
+// The callback must be safe to run concurrently, eg accumulate per chunk index and combine
+// the results afterwards.
+template <typename Callback>
+void parallel_for_each_chunk(std::string_view buffer, Callback&& callback, unsigned threads = 0,
+                             std::size_t chunks = 0) {
+  if (threads == 0) threads = std::max(1U, std::thread::hardware_concurrency());
+  if (chunks == 0) chunks = 4UL * threads;
+  const auto pieces = split_chunks(buffer, chunks);
+  os::algo::parallel_for(pieces.size(), threads,
+                         [&](std::size_t i) { callback(i, pieces[i]); });
+}
+
+// how a mapping will be read, passed to madvise()
+enum class access { normal, sequential, random };
+
+// All hints are best effort: the kernel may ignore them (eg huge pages for file mappings need a
+// filesystem with large folio support) and a failing madvise() is not an error.
+struct map_options {
+  access advice     = access::normal;
+  bool   willneed   = false; // start reading the whole file ahead (MADV_WILLNEED)
+  bool   populate   = false; // prefault all pages during mmap() (MAP_POPULATE)
+  bool   huge_pages = false; // back the mapping with transparent huge pages (MADV_HUGEPAGE)
+};
+
 class MemoryMappedFile {
 public:
-  explicit MemoryMappedFile(const std::string& filename) {
-    int fd = open(filename.c_str(), O_RDONLY); // NOLINT
-    if (fd == -1) throw std::logic_error("MemoryMappedFile: couldn't open file.");
+  explicit MemoryMappedFile(const std::string& filename, const map_options& options = {}) {
+    fd_ = open(filename.c_str(), O_RDONLY); // NOLINT
+    if (fd_ == -1) throw std::logic_error("MemoryMappedFile: couldn't open file.");
 
     // obtain file size
     struct stat sbuf {};
-    if (fstat(fd, &sbuf) == -1) throw std::logic_error("MemoryMappedFile: cannot stat file size");
+    if (fstat(fd_, &sbuf) == -1) {
+      close(fd_);
+      throw std::logic_error("MemoryMappedFile: cannot stat file size");
+    }
     filesize_ = static_cast<std::size_t>(sbuf.st_size);
+    if (filesize_ == 0) return; // mmap() rejects empty ranges. begin() == end() == nullptr
 
-    map_ = static_cast<const char*>(mmap(nullptr, filesize_, PROT_READ, MAP_PRIVATE, fd, 0U));
-    if (map_ == MAP_FAILED) // NOLINT c-style cast in macro + int to ptr cast pessimisation
+    int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+    if (options.populate) flags |= MAP_POPULATE;
+#endif
+    void* map = mmap(nullptr, filesize_, PROT_READ, flags, fd_, 0U);
+    if (map == MAP_FAILED) { // NOLINT c-style cast in macro + int to ptr cast pessimisation
+      close(fd_);
       throw std::logic_error("MemoryMappedFile: cannot map file");
+    }
+    map_ = static_cast<const char*>(map);
+
+#ifdef MADV_HUGEPAGE
+    if (options.huge_pages) madvise_range(0, filesize_, MADV_HUGEPAGE);
+#endif
+    advise(options.advice);
+    if (options.willneed) will_need(0, filesize_);
   }
 
   ~MemoryMappedFile() {
-    if (munmap(static_cast<void*>(const_cast<char*>(map_)), filesize_) == -1) // NOLINT const_cast
+    if (map_ != nullptr &&
+        munmap(static_cast<void*>(const_cast<char*>(map_)), filesize_) == -1) // NOLINT const_cast
       std::cerr << "Warnng: MemoryMappedFile: error in destructor during `munmap()`\n";
+    if (fd_ != -1) close(fd_);
   }
 
   // no copies
   MemoryMappedFile(const MemoryMappedFile& other) = delete;
-  MemoryMappedFile& operator=(MemoryMappedFile other) = delete;
+  MemoryMappedFile& operator=(const MemoryMappedFile& other) = delete;
 
-  // default moves
-  MemoryMappedFile(MemoryMappedFile&& other) = default;
-  MemoryMappedFile& operator=(MemoryMappedFile&& other) = default;
+  // moved from objects own nothing
+  MemoryMappedFile(MemoryMappedFile&& other) noexcept
+      : filesize_{std::exchange(other.filesize_, 0)}, map_{std::exchange(other.map_, nullptr)},
+        fd_{std::exchange(other.fd_, -1)} {}
+
+  // our mapping is released by `other`'s destructor
+  MemoryMappedFile& operator=(MemoryMappedFile&& other) noexcept {
+    std::swap(filesize_, other.filesize_);
+    std::swap(map_, other.map_);
+    std::swap(fd_, other.fd_);
+    return *this;
+  }
 
   // char* pointers. up to callee to make string_views or strings
   [[nodiscard]] const char* begin() const { return map_; }
@@ -61,9 +229,621 @@ public:
     return std::string_view{begin(), static_cast<std::size_t>(end() - begin())};
   }
 
+  [[nodiscard]] line_view lines() const { return line_view{get_buffer()}; }
+
+  [[nodiscard]] std::size_t size() const { return filesize_; }
+
+  // change the access pattern hint for the whole mapping
+  void advise(access advice) const {
+    switch (advice) {
+    case access::normal: madvise_range(0, filesize_, MADV_NORMAL); break;
+    case access::sequential: madvise_range(0, filesize_, MADV_SEQUENTIAL); break;
+    case access::random: madvise_range(0, filesize_, MADV_RANDOM); break;
+    }
+  }
+
+  // start reading [offset, offset + length) in the background
+  void will_need(std::size_t offset, std::size_t length) const {
+    madvise_range(offset, length, MADV_WILLNEED);
+  }
+
+  // Unmaps the whole pages inside [offset, offset + length) from this process and asks the
+  // kernel to evict them from the page cache. Touching them again reads them back from disk.
+  void dont_need(std::size_t offset, std::size_t length) const {
+    const std::size_t first = round_up(std::min(offset, filesize_));
+    const std::size_t stop  = std::min(offset + length, filesize_);
+    const std::size_t last  = stop == filesize_ ? stop : round_down(stop); // partial last page
+    if (first >= last) return;
+    madvise_range(first, last - first, MADV_DONTNEED);
+    posix_fadvise(fd_, static_cast<off_t>(first), static_cast<off_t>(last - first),
+                  POSIX_FADV_DONTNEED);
+  }
+
+  static std::size_t page_size() {
+    static const auto size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    return size;
+  }
+
 private:
+  static std::size_t round_down(std::size_t n) { return n - n % page_size(); }
+  static std::size_t round_up(std::size_t n) { return round_down(n + page_size() - 1); }
+
+  // madvise() wants a page aligned start, so extend the range down to the page boundary
+  void madvise_range(std::size_t offset, std::size_t length, int advice) const {
+    if (offset >= filesize_ || length == 0) return;
+    const std::size_t first = round_down(offset);
+    const std::size_t last  = std::min(offset + length, filesize_);
+    madvise(const_cast<char*>(map_) + first, last - first, advice); // NOLINT hint only
+  }
+
   std::size_t filesize_ = 0;
   const char* map_      = nullptr;
+  int         fd_       = -1;
+};
+
+// Keeps the kernel reading ahead of a cursor streaming through a MemoryMappedFile and drops the
+// pages it has left behind, so one pass over a file much larger than RAM neither stalls on page
+// faults nor fills the page cache. Call advance() with the current position as often as
+// convenient; madvise() is only called every half window.
+class prefetch_window {
+public:
+  explicit prefetch_window(const MemoryMappedFile& file, std::size_t ahead = 64UL << 20U,
+                           std::size_t behind = 4UL << 20U)
+      : file_{&file}, ahead_{std::max(ahead, MemoryMappedFile::page_size())}, behind_{behind} {
+    advance(std::size_t{0});
+  }
+
+  void advance(const char* cursor) { advance(static_cast<std::size_t>(cursor - file_->begin())); }
+
+  void advance(std::size_t offset) {
+    const std::size_t size = file_->size();
+    if (advised_ < size && offset + ahead_ / 2 >= advised_) {
+      const std::size_t last = std::min(size, std::max(offset, advised_) + ahead_);
+      file_->will_need(advised_, last - advised_);
+      advised_ = last;
+    }
+    if (offset >= dropped_ + 2 * behind_ + ahead_ / 2) {
+      const std::size_t last = offset - behind_;
+      file_->dont_need(dropped_, last - dropped_);
+      dropped_ = last - last % MemoryMappedFile::page_size();
+    }
+  }
+
+  // release everything up to `offset`, eg at the end of the scan
+  void release(std::size_t offset) {
+    if (offset <= dropped_) return;
+    file_->dont_need(dropped_, offset - dropped_);
+    dropped_ = std::min(offset, file_->size());
+  }
+
+private:
+  const MemoryMappedFile* file_;
+  std::size_t             ahead_;
+  std::size_t             behind_;
+  std::size_t             advised_ = 0; // will_need() issued up to here
+  std::size_t             dropped_ = 0; // dont_need() issued up to here
+};
+
+struct stream_options {
+  std::size_t chunk_size = 4UL << 20U; // bytes per read, rounded up to the 4096 byte alignment
+  unsigned    depth      = 4;          // buffers in flight, each filled by its own reader thread
+  bool        direct     = false;      // bypass the page cache with O_DIRECT, if supported
+};
+
+// Reads a file front to back with `depth` pread() calls in flight into aligned buffers, as an
+// alternative to MemoryMappedFile when page faults are slow or unpredictable (files larger than
+// RAM, network block devices). Reader threads stand in for io_uring, which needs liburing or raw
+// syscall plumbing that this header does not carry.
+//
+// next() returns record aligned chunks: each ends just after a '\n', except a last line without
+// one, so the same parsing code, eg `for (auto line: lines(chunk))`, runs on either backend. A
+// record straddling two reads is stitched into a separate small chunk. A chunk stays valid until
+// the following call to next(); an empty chunk means end of file.
+class StreamingReader {
+public:
+  static constexpr std::size_t alignment = 4096;
+
+  explicit StreamingReader(const std::string& filename, const stream_options& options = {})
+      : chunk_size_{(std::max<std::size_t>(options.chunk_size, 1) + alignment - 1) / alignment *
+                    alignment},
+        depth_{std::max(1U, options.depth)} {
+#ifdef O_DIRECT
+    if (options.direct) fd_ = open(filename.c_str(), O_RDONLY | O_DIRECT); // NOLINT
+    direct_ = fd_ != -1;
+#endif
+    if (fd_ == -1) fd_ = open(filename.c_str(), O_RDONLY); // NOLINT, also when O_DIRECT fails
+    if (fd_ == -1) throw std::logic_error("StreamingReader: couldn't open file.");
+
+    struct stat sbuf {};
+    if (fstat(fd_, &sbuf) == -1) {
+      close(fd_);
+      throw std::logic_error("StreamingReader: cannot stat file size");
+    }
+    filesize_ = static_cast<std::size_t>(sbuf.st_size);
+    chunks_   = (filesize_ + chunk_size_ - 1) / chunk_size_;
+    if (!direct_) posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    slots_ = std::vector<slot>(depth_);
+    for (auto& s: slots_) {
+      s.buffer.reset(static_cast<char*>(std::aligned_alloc(alignment, chunk_size_)));
+      if (!s.buffer) {
+        close(fd_);
+        throw std::bad_alloc();
+      }
+    }
+    threads_.reserve(depth_);
+    try {
+      for (unsigned i = 0; i != depth_; ++i) threads_.emplace_back([this] { read_chunks(); });
+    } catch (...) { // the threads already started point at this, which is never constructed
+      stop_readers();
+      close(fd_);
+      throw;
+    }
+  }
+
+  ~StreamingReader() {
+    stop_readers();
+    close(fd_);
+  }
+
+  // owns threads which point back at it
+  StreamingReader(const StreamingReader& other) = delete;
+  StreamingReader& operator=(const StreamingReader& other) = delete;
+  StreamingReader(StreamingReader&& other)                 = delete;
+  StreamingReader& operator=(StreamingReader&& other) = delete;
+
+  [[nodiscard]] std::size_t size() const { return filesize_; }
+  [[nodiscard]] bool        direct() const { return direct_; }
+
+  std::string_view next() {
+    if (!rest_.empty()) return std::exchange(rest_, std::string_view{});
+    while (true) {
+      const std::string_view raw = next_raw();
+      if (raw.empty()) { // end of file, flush an unterminated last line
+        stitched_.swap(carry_);
+        carry_.clear();
+        return stitched_;
+      }
+      const std::size_t last = raw.rfind('\n');
+      if (last == std::string_view::npos) { // a record longer than a chunk
+        carry_.append(raw);
+        continue;
+      }
+      if (carry_.empty()) {
+        carry_.assign(raw.substr(last + 1));
+        return raw.substr(0, last + 1);
+      }
+      const std::size_t first = raw.find('\n');
+      stitched_.assign(carry_).append(raw.substr(0, first + 1));
+      rest_ = raw.substr(first + 1, last - first);
+      carry_.assign(raw.substr(last + 1));
+      return stitched_;
+    }
+  }
+
+  // callback(chunk) for each record aligned chunk
+  template <typename Callback>
+  void for_each_chunk(Callback&& callback) {
+    for (std::string_view chunk = next(); !chunk.empty(); chunk = next()) callback(chunk);
+  }
+
+private:
+  struct free_deleter {
+    void operator()(char* p) const { std::free(p); } // NOLINT
+  };
+
+  struct slot {
+    std::unique_ptr<char, free_deleter> buffer;
+    std::size_t                         length = 0;
+    std::size_t                         filled = 0; // 1 + the index of the chunk in buffer
+    int                                 error  = 0;
+  };
+
+  void stop_readers() {
+    {
+      std::lock_guard lock(mutex_);
+      stop_ = true;
+    }
+    free_.notify_all();
+    for (auto& t: threads_) t.join();
+  }
+
+  // reader thread: claim the next chunk once its slot has been handed back, then fill it
+  void read_chunks() {
+    std::unique_lock lock(mutex_);
+    while (true) {
+      free_.wait(lock, [this] {
+        return stop_ || (issued_ < chunks_ && issued_ < released_ + depth_);
+      });
+      if (stop_) return;
+      const std::size_t chunk = issued_++;
+      slot&             s     = slots_[chunk % depth_];
+      lock.unlock();
+
+      const std::size_t offset = chunk * chunk_size_;
+      const std::size_t want   = std::min(chunk_size_, filesize_ - offset);
+      std::size_t       got    = 0;
+      int               error  = 0;
+      while (got < want) {
+        const ssize_t n = pread(fd_, s.buffer.get() + got, chunk_size_ - got, // NOLINT
+                                static_cast<off_t>(offset + got));
+        if (n == -1 && errno == EINTR) continue;
+        if (n <= 0) {
+          error = n == -1 ? errno : EIO;
+          break;
+        }
+        const std::size_t before = got;
+        got += static_cast<std::size_t>(n);
+        // O_DIRECT needs an aligned offset, so after a short read before the end of the file
+        // the tail of it is read again from the last aligned position
+        if (direct_ && got < want) {
+          got -= got % alignment;
+          if (got == before) { // less than one block per read, no progress
+            error = EIO;
+            break;
+          }
+        }
+      }
+
+      lock.lock();
+      s.length = std::min(got, want);
+      s.error  = error;
+      s.filled = chunk + 1;
+      ready_.notify_all();
+    }
+  }
+
+  // the next buffer in file order, the previous one is handed back to the readers
+  std::string_view next_raw() {
+    std::unique_lock lock(mutex_);
+    if (consumed_ != released_) {
+      ++released_;
+      free_.notify_all();
+    }
+    if (consumed_ == chunks_) return {};
+    slot& s = slots_[consumed_ % depth_];
+    ready_.wait(lock, [&] { return s.filled == consumed_ + 1; });
+    if (s.error != 0) throw std::logic_error("StreamingReader: read error");
+    ++consumed_;
+    return {s.buffer.get(), s.length};
+  }
+
+  std::size_t filesize_ = 0;
+  std::size_t chunk_size_;
+  std::size_t chunks_ = 0;
+  unsigned    depth_;
+  int         fd_     = -1;
+  bool        direct_ = false;
+
+  std::vector<slot>        slots_;
+  std::vector<std::thread> threads_;
+  std::mutex               mutex_;
+  std::condition_variable  free_;  // a slot was handed back, or stop
+  std::condition_variable  ready_; // a slot was filled
+  std::size_t              issued_   = 0; // chunks claimed by readers
+  std::size_t              consumed_ = 0; // chunks returned by next_raw()
+  std::size_t              released_ = 0; // chunks handed back to the readers
+  bool                     stop_     = false;
+
+  std::string      carry_;    // unterminated record at the end of the last buffer
+  std::string      stitched_; // carry_ + the head of the following buffer
+  std::string_view rest_;     // remainder of the buffer after stitched_
+};
+
+// how WritableMemoryMappedFile::flush() waits for the write back
+enum class flush_mode {
+  async, // schedule the write back and return (MS_ASYNC)
+  sync   // return once the pages are on disk (MS_SYNC)
+};
+
+// A read/write MAP_SHARED mapping, for writing large outputs straight into the page cache.
+// The file is created if needed and existing contents are kept. Writes reach the file without
+// any flush; flush() only controls when they are on disk.
+//
+// size() is the logical length, which can be grown with resize() or append(). The file and the
+// mapping grow geometrically with ftruncate() and mremap(), so appends are amortised O(1), and
+// the file is cut back to size() by shrink_to_fit() and the destructor. Growing may move the
+// mapping and invalidates pointers into it.
+class WritableMemoryMappedFile {
+public:
+  explicit WritableMemoryMappedFile(const std::string& filename, std::size_t size = 0) {
+    fd_ = open(filename.c_str(), O_RDWR | O_CREAT, 0644); // NOLINT
+    if (fd_ == -1) throw std::logic_error("WritableMemoryMappedFile: couldn't open file.");
+
+    struct stat sbuf {};
+    if (fstat(fd_, &sbuf) == -1) {
+      close(fd_);
+      throw std::logic_error("WritableMemoryMappedFile: cannot stat file size");
+    }
+    try {
+      remap(static_cast<std::size_t>(sbuf.st_size));
+      size_ = capacity_;
+      resize(std::max(size, size_));
+    } catch (...) {
+      if (map_ != nullptr) munmap(map_, capacity_);
+      close(fd_);
+      throw;
+    }
+  }
+
+  ~WritableMemoryMappedFile() {
+    if (map_ != nullptr && munmap(map_, capacity_) == -1)
+      std::cerr << "Warnng: WritableMemoryMappedFile: error in destructor during `munmap()`\n";
+    if (fd_ == -1) return;
+    if (capacity_ != size_ && ftruncate(fd_, static_cast<off_t>(size_)) == -1)
+      std::cerr << "Warnng: WritableMemoryMappedFile: error in destructor during `ftruncate()`\n";
+    close(fd_);
+  }
+
+  // no copies
+  WritableMemoryMappedFile(const WritableMemoryMappedFile& other) = delete;
+  WritableMemoryMappedFile& operator=(const WritableMemoryMappedFile& other) = delete;
+
+  // moved from objects own nothing
+  WritableMemoryMappedFile(WritableMemoryMappedFile&& other) noexcept
+      : size_{std::exchange(other.size_, 0)}, capacity_{std::exchange(other.capacity_, 0)},
+        map_{std::exchange(other.map_, nullptr)}, fd_{std::exchange(other.fd_, -1)} {}
+
+  // our mapping is released by `other`'s destructor
+  WritableMemoryMappedFile& operator=(WritableMemoryMappedFile&& other) noexcept {
+    std::swap(size_, other.size_);
+    std::swap(capacity_, other.capacity_);
+    std::swap(map_, other.map_);
+    std::swap(fd_, other.fd_);
+    return *this;
+  }
+
+  [[nodiscard]] char*       data() { return map_; }
+  [[nodiscard]] const char* data() const { return map_; }
+  [[nodiscard]] char*       begin() { return map_; }
+  [[nodiscard]] char*       end() { return map_ + size_; } // NOLINT
+  [[nodiscard]] const char* begin() const { return map_; }
+  [[nodiscard]] const char* end() const { return map_ + size_; } // NOLINT
+
+  [[nodiscard]] std::size_t size() const { return size_; }
+  [[nodiscard]] std::size_t capacity() const { return capacity_; }
+  [[nodiscard]] bool        empty() const { return size_ == 0; }
+
+  [[nodiscard]] std::string_view get_buffer() const { return std::string_view{map_, size_}; }
+
+  // new bytes read as zero
+  void resize(std::size_t size) {
+    if (size > capacity_) reserve(std::max(size, 2 * capacity_));
+    size_ = size;
+  }
+
+  // grows the file and the mapping to at least `capacity` bytes
+  void reserve(std::size_t capacity) {
+    if (capacity <= capacity_) return;
+    capacity = round_up(capacity);
+    if (ftruncate(fd_, static_cast<off_t>(capacity)) == -1)
+      throw std::logic_error("WritableMemoryMappedFile: cannot grow file");
+    remap(capacity);
+  }
+
+  // cuts the file and the mapping back to size()
+  void shrink_to_fit() {
+    if (capacity_ == size_) return;
+    if (ftruncate(fd_, static_cast<off_t>(size_)) == -1)
+      throw std::logic_error("WritableMemoryMappedFile: cannot shrink file");
+    remap(size_);
+  }
+
+  void append(const void* src, std::size_t count) {
+    const std::size_t offset = size_;
+    resize(size_ + count);
+    if (count != 0) std::memcpy(map_ + offset, src, count); // NOLINT
+  }
+
+  void append(std::string_view sv) { append(sv.data(), sv.size()); }
+
+  // writes back the dirty pages overlapping [offset, offset + length)
+  void flush(std::size_t offset, std::size_t length, flush_mode mode = flush_mode::sync) {
+    if (offset >= size_ || length == 0) return;
+    const std::size_t first = offset - offset % MemoryMappedFile::page_size();
+    const std::size_t last  = std::min(offset + length, size_);
+    if (msync(map_ + first, last - first, mode == flush_mode::sync ? MS_SYNC : MS_ASYNC) == -1)
+      throw std::logic_error("WritableMemoryMappedFile: cannot flush mapping");
+  }
+
+  void flush(flush_mode mode = flush_mode::sync) { flush(0, size_, mode); }
+
+private:
+  static std::size_t round_up(std::size_t n) {
+    const std::size_t page = MemoryMappedFile::page_size();
+    return (n + page - 1) / page * page;
+  }
+
+  // map [0, capacity) of the file, which is already at least that long
+  void remap(std::size_t capacity) {
+    void* map = nullptr;
+    if (capacity == 0) {
+      if (map_ != nullptr) munmap(map_, capacity_);
+    } else if (map_ == nullptr) {
+      map = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0U);
+    } else {
+      map = mremap(map_, capacity_, capacity, MREMAP_MAYMOVE);
+    }
+    if (map == MAP_FAILED) // NOLINT c-style cast in macro + int to ptr cast pessimisation
+      throw std::logic_error("WritableMemoryMappedFile: cannot map file");
+    map_      = static_cast<char*>(map);
+    capacity_ = capacity;
+  }
+
+  std::size_t size_     = 0; // logical length
+  std::size_t capacity_ = 0; // file length == mapped length
+  char*       map_      = nullptr;
+  int         fd_       = -1;
+};
+
+enum class write_mode { truncate, append };
+
+// Buffered writer straight to a file descriptor with write(), bypassing stdio and its locking.
+// Appends that do not fit in the buffer are written together with it by one writev(), so large
+// pieces are never copied. Numbers are formatted with std::to_chars, ie locale independent and
+// shortest round trip for floating point.
+//
+// It is a sink for os::str::join (via append(string_view)) and a std::streambuf, so ostream
+// based printers work unchanged through stream():
+//
+//   os::fs::FileWriter out(STDOUT_FILENO);
+//   out.stream() << os::hd(value);
+//   os::str::join(out, values, ", ", "\n");
+//
+// Write errors throw std::logic_error, except from the destructor, which only reports them.
+class FileWriter : public std::streambuf {
+public:
+  explicit FileWriter(const std::string& filename, std::size_t buffer_size = 1UL << 20U,
+                      write_mode mode = write_mode::truncate)
+      : FileWriter(buffer_size) {
+    // not O_APPEND, under which Linux ignores the offset given to pwrite()
+    const int flags = O_WRONLY | O_CREAT | (mode == write_mode::truncate ? O_TRUNC : 0);
+    fd_             = open(filename.c_str(), flags, 0644); // NOLINT
+    if (fd_ == -1) throw std::logic_error("FileWriter: couldn't open file.");
+    owns_fd_ = true;
+    if (mode == write_mode::append && lseek(fd_, 0, SEEK_END) == -1) {
+      close(fd_);
+      throw std::logic_error("FileWriter: cannot seek to end of file");
+    }
+  }
+
+  // write to an already open descriptor, eg STDOUT_FILENO, which is not closed
+  explicit FileWriter(int fd, std::size_t buffer_size = 1UL << 16U) : FileWriter(buffer_size) {
+    fd_ = fd;
+  }
+
+  ~FileWriter() override {
+    try {
+      flush();
+    } catch (const std::exception&) {
+      std::cerr << "Warnng: FileWriter: error in destructor during `write()`\n";
+    }
+    if (owns_fd_) close(fd_);
+  }
+
+  // the stream and the buffer point at each other
+  FileWriter(const FileWriter& other) = delete;
+  FileWriter& operator=(const FileWriter& other) = delete;
+  FileWriter(FileWriter&& other)                 = delete;
+  FileWriter& operator=(FileWriter&& other) = delete;
+
+  std::ostream& stream() { return stream_; }
+
+  void append(std::string_view sv) {
+    if (sv.size() <= space()) {
+      put(sv.data(), sv.size());
+    } else if (sv.size() < buffer_.size()) {
+      flush();
+      put(sv.data(), sv.size());
+    } else {
+      write_both(sv); // too big to buffer
+    }
+  }
+
+  void append(char c) { push_back(c); }
+
+  // a string literal or C string, which would otherwise convert to bool below
+  void append(const char* s) { append(std::string_view(s)); }
+
+  // "1" or "0" like an ostream, rather than the converted char
+  void append(bool b) { push_back(b ? '1' : '0'); }
+
+  void push_back(char c) {
+    if (space() == 0) flush();
+    *pptr() = c;
+    pbump(1);
+  }
+
+  template <typename T, typename = std::enable_if_t<std::is_arithmetic_v<T> &&
+                                                    !std::is_same_v<T, bool> &&
+                                                    !std::is_same_v<T, char>>>
+  void append(T value) {
+    constexpr std::size_t max_chars = 64; // enough for any integer or shortest double
+    if (space() < max_chars) flush();
+    const auto [end, ec] = std::to_chars(pptr(), epptr(), value);
+    if (ec != std::errc{}) throw std::logic_error("FileWriter: cannot format number");
+    pbump(static_cast<int>(end - pptr()));
+  }
+
+  template <typename T>
+  FileWriter& operator<<(const T& value) {
+    append(value);
+    return *this;
+  }
+
+  // Writes at `offset` without moving the file position, eg to patch a header. Buffered data
+  // is written first, so it cannot overwrite the patch later.
+  void pwrite(std::size_t offset, std::string_view sv) {
+    flush();
+    std::size_t done = 0;
+    while (done < sv.size()) {
+      const ssize_t n = ::pwrite(fd_, sv.data() + done, sv.size() - done, // NOLINT
+                                 static_cast<off_t>(offset + done));
+      if (n == -1 && errno == EINTR) continue;
+      if (n == -1) throw std::logic_error("FileWriter: pwrite error");
+      done += static_cast<std::size_t>(n);
+    }
+  }
+
+  // write the buffer out, it does not fsync()
+  void flush() { write_both({}); }
+
+  [[nodiscard]] int fd() const { return fd_; }
+
+protected:
+  int_type overflow(int_type ch) override {
+    flush();
+    if (!traits_type::eq_int_type(ch, traits_type::eof())) push_back(traits_type::to_char_type(ch));
+    return traits_type::not_eof(ch);
+  }
+
+  std::streamsize xsputn(const char_type* s, std::streamsize count) override {
+    append(std::string_view(s, static_cast<std::size_t>(count)));
+    return count;
+  }
+
+  int sync() override {
+    flush();
+    return 0;
+  }
+
+private:
+  // pbump() takes an int, so the buffer is capped at INT_MAX
+  explicit FileWriter(std::size_t buffer_size)
+      : buffer_(std::clamp<std::size_t>(buffer_size, 64, INT_MAX)), stream_{this} {
+    setp(buffer_.data(), buffer_.data() + buffer_.size()); // NOLINT
+  }
+
+  [[nodiscard]] std::size_t space() const { return static_cast<std::size_t>(epptr() - pptr()); }
+
+  void put(const char* src, std::size_t count) {
+    std::memcpy(pptr(), src, count);
+    pbump(static_cast<int>(count));
+  }
+
+  // writes the buffered bytes followed by `tail`, with as few system calls as possible
+  void write_both(std::string_view tail) {
+    std::array<iovec, 2> iov{{{pbase(), static_cast<std::size_t>(pptr() - pbase())},
+                              {const_cast<char*>(tail.data()), tail.size()}}}; // NOLINT
+    setp(buffer_.data(), buffer_.data() + buffer_.size());                       // NOLINT
+    std::size_t first = iov[0].iov_len == 0 ? 1 : 0;
+    while (first != iov.size() && iov[first].iov_len != 0) {
+      const ssize_t n = writev(fd_, &iov[first], static_cast<int>(iov.size() - first)); // NOLINT
+      if (n == -1 && errno == EINTR) continue;
+      if (n == -1) throw std::logic_error("FileWriter: write error");
+      auto done = static_cast<std::size_t>(n);
+      while (first != iov.size() && done >= iov[first].iov_len) done -= iov[first++].iov_len;
+      if (first != iov.size()) {
+        iov[first].iov_base = static_cast<char*>(iov[first].iov_base) + done; // NOLINT
+        iov[first].iov_len -= done;
+      }
+    }
+  }
+
+  std::vector<char> buffer_;
+  std::ostream      stream_;
+  int               fd_      = -1;
+  bool              owns_fd_ = false;
 };
 
 } // namespace os::fs
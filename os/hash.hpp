@@ -0,0 +1,241 @@
+#pragma once
+
+#include "os/simd.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace os::hash {
+
+// Fast, non cryptographic 64 bit hash of a byte range, in the style of wyhash: 16 bytes per
+// step folded with 64x64->128 bit multiplies, and short keys read with a few overlapping loads
+// instead of a byte loop. Good distribution in all bits, so tables can mask off low bits or use
+// the high bits as a tag.
+namespace detail {
+
+constexpr std::uint64_t k0 = 0xa0761d6478bd642fULL;
+constexpr std::uint64_t k1 = 0xe7037ed1a0b428dbULL;
+constexpr std::uint64_t k2 = 0x8ebc6af09c88c6e3ULL;
+
+__extension__ typedef unsigned __int128 uint128_t; // NOLINT, a gcc/clang extension
+
+inline std::uint64_t mix(std::uint64_t a, std::uint64_t b) {
+  const auto r = static_cast<uint128_t>(a) * b;
+  return static_cast<std::uint64_t>(r) ^ static_cast<std::uint64_t>(r >> 64U);
+}
+
+inline std::uint64_t read64(const unsigned char* p) {
+  std::uint64_t v = 0;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+inline std::uint64_t read32(const unsigned char* p) {
+  std::uint32_t v = 0;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+} // namespace detail
+
+inline std::uint64_t bytes(const void* data, std::size_t size, std::uint64_t seed = 0) noexcept {
+  using detail::k0;
+  using detail::k1;
+  using detail::k2;
+  using detail::mix;
+  using detail::read32;
+  using detail::read64;
+
+  const auto*   p = static_cast<const unsigned char*>(data);
+  std::uint64_t a = 0;
+  std::uint64_t b = 0;
+  seed ^= k0;
+  if (size <= 16) {
+    if (size >= 4) {
+      const std::size_t mid = (size >> 3U) << 2U;                      // 0 or 4
+      a = (read32(p) << 32U) | read32(p + mid);                        // NOLINT
+      b = (read32(p + size - 4) << 32U) | read32(p + size - 4 - mid); // NOLINT
+    } else if (size > 0) {
+      a = (std::uint64_t{p[0]} << 16U) | (std::uint64_t{p[size >> 1U]} << 8U) | // NOLINT
+          p[size - 1];                                                          // NOLINT
+    }
+  } else {
+    std::size_t left = size;
+    for (; left > 16; left -= 16, p += 16) // NOLINT
+      seed = mix(read64(p) ^ k1, read64(p + 8) ^ seed); // NOLINT
+    a = read64(p + left - 16); // NOLINT the last 16 bytes, overlapping
+    b = read64(p + left - 8);  // NOLINT
+  }
+  return mix(k2 ^ size, mix(a ^ k1, b ^ seed));
+}
+
+inline std::uint64_t bytes(std::string_view sv, std::uint64_t seed = 0) noexcept {
+  return bytes(sv.data(), sv.size(), seed);
+}
+
+// for std::unordered_map<std::string, T, os::hash::string_hash, std::equal_to<>>, which can
+// then be searched with a string_view without building a std::string (C++20 lookup)
+struct string_hash {
+  using is_transparent = void;
+
+  std::size_t operator()(std::string_view sv) const noexcept { return bytes(sv); }
+  std::size_t operator()(const std::string& s) const noexcept { return bytes(s); }
+  std::size_t operator()(const char* s) const noexcept { return bytes(std::string_view{s}); }
+};
+
+// Open addressing hash map from string_view to T, laid out like Abseil's SwissTable: one control
+// byte per slot holds 7 bits of the hash (or "empty"), and a lookup compares a group of 16
+// control bytes at once (SSE2, which baseline x86-64 has, so no dispatch), and keys are only
+// compared on a likely match. Slots are a flat array, so there are no per entry allocations.
+// Groups are probed triangularly and the table grows at 7/8 load. There is no erase.
+//
+// The map does not own the characters of its keys: they must outlive it, eg point into a
+// mapped file, or be copied on insertion with try_emplace(key, store) as os::str::word_counter
+// does.
+template <typename T>
+class string_map {
+public:
+  static constexpr std::size_t group_size = 16;
+
+  string_map() = default;
+
+  [[nodiscard]] std::size_t size() const { return size_; }
+  [[nodiscard]] bool        empty() const { return size_ == 0; }
+  [[nodiscard]] std::size_t capacity() const { return ctrl_.size(); }
+
+  // room for `n` entries without growing
+  void reserve(std::size_t n) {
+    std::size_t cap = group_size;
+    while (cap * 7 / 8 < n) cap *= 2;
+    if (cap > capacity()) rehash(cap);
+  }
+
+  void clear() {
+    std::fill(ctrl_.begin(), ctrl_.end(), empty_slot);
+    size_ = 0;
+  }
+
+  [[nodiscard]] T* find(std::string_view key) {
+    return const_cast<T*>(std::as_const(*this).find(key)); // NOLINT
+  }
+
+  [[nodiscard]] const T* find(std::string_view key) const {
+    if (size_ == 0) return nullptr;
+    const std::uint64_t h = bytes(key);
+    for (prober p(h, groups());; p.next()) {
+      const std::size_t base = p.group * group_size;
+      for (std::uint32_t m = match(base, tag_of(h)); m != 0; m &= m - 1) {
+        const std::size_t i = base + static_cast<std::size_t>(__builtin_ctz(m));
+        if (slots_[i].first == key) return &slots_[i].second;
+      }
+      if (match(base, empty_slot) != 0) return nullptr;
+    }
+  }
+
+  // Inserts T{} for a new key. `store(key)` returns the string_view to keep for a new key, eg a
+  // copy. Returns the value and whether it was inserted.
+  template <typename KeyStore>
+  std::pair<T*, bool> try_emplace(std::string_view key, KeyStore&& store) {
+    if ((size_ + 1) * 8 > capacity() * 7) rehash(std::max(2 * capacity(), group_size));
+    const std::uint64_t h = bytes(key);
+    for (prober p(h, groups());; p.next()) {
+      const std::size_t base = p.group * group_size;
+      for (std::uint32_t m = match(base, tag_of(h)); m != 0; m &= m - 1) {
+        const std::size_t i = base + static_cast<std::size_t>(__builtin_ctz(m));
+        if (slots_[i].first == key) return {&slots_[i].second, false};
+      }
+      if (const std::uint32_t e = match(base, empty_slot); e != 0) {
+        const std::size_t i = base + static_cast<std::size_t>(__builtin_ctz(e));
+        ctrl_[i]            = tag_of(h);
+        slots_[i]           = {store(key), T{}};
+        ++size_;
+        return {&slots_[i].second, true};
+      }
+    }
+  }
+
+  std::pair<T*, bool> try_emplace(std::string_view key) {
+    return try_emplace(key, [](std::string_view k) { return k; });
+  }
+
+  T& operator[](std::string_view key) { return *try_emplace(key).first; }
+
+  // fn(key, value) for each entry, in no particular order
+  template <typename Fn>
+  void for_each(Fn&& fn) const {
+    for (std::size_t i = 0; i != ctrl_.size(); ++i)
+      if (ctrl_[i] != empty_slot) fn(slots_[i].first, slots_[i].second);
+  }
+
+  template <typename Fn>
+  void for_each(Fn&& fn) {
+    for (std::size_t i = 0; i != ctrl_.size(); ++i)
+      if (ctrl_[i] != empty_slot) fn(slots_[i].first, slots_[i].second);
+  }
+
+private:
+  static constexpr std::uint8_t empty_slot = 0x80; // full slots hold a 7 bit tag
+
+  static std::uint8_t tag_of(std::uint64_t h) { return static_cast<std::uint8_t>(h & 0x7fU); }
+
+  // visits groups h, h+1, h+3, h+6, ... which covers all groups when their count is a power of 2
+  struct prober {
+    prober(std::uint64_t h, std::size_t groups)
+        : mask{groups - 1}, group{static_cast<std::size_t>(h >> 7U) & mask} {}
+    void next() {
+      ++step;
+      group = (group + step) & mask;
+    }
+    std::size_t mask;
+    std::size_t group;
+    std::size_t step = 0;
+  };
+
+  [[nodiscard]] std::size_t groups() const { return ctrl_.size() / group_size; }
+
+  // bit i set if control byte base + i equals `c`
+  [[nodiscard]] std::uint32_t match(std::size_t base, std::uint8_t c) const {
+#if OS_SIMD_X86
+    const __m128i group = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&ctrl_[base])); // NOLINT
+    return static_cast<std::uint32_t>(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(static_cast<char>(c)))));
+#else
+    std::uint32_t m = 0;
+    for (std::size_t i = 0; i != group_size; ++i)
+      m |= static_cast<std::uint32_t>(ctrl_[base + i] == c) << i;
+    return m;
+#endif
+  }
+
+  void rehash(std::size_t cap) {
+    std::vector<std::uint8_t>                   old_ctrl(cap, empty_slot);
+    std::vector<std::pair<std::string_view, T>> old_slots(cap);
+    old_ctrl.swap(ctrl_);
+    old_slots.swap(slots_);
+    for (std::size_t i = 0; i != old_ctrl.size(); ++i) {
+      if (old_ctrl[i] == empty_slot) continue;
+      const std::uint64_t h = bytes(old_slots[i].first);
+      for (prober p(h, groups());; p.next()) {
+        const std::size_t   base = p.group * group_size;
+        const std::uint32_t e    = match(base, empty_slot);
+        if (e == 0) continue;
+        const std::size_t j = base + static_cast<std::size_t>(__builtin_ctz(e));
+        ctrl_[j]            = tag_of(h);
+        slots_[j]           = std::move(old_slots[i]);
+        break;
+      }
+    }
+  }
+
+  std::vector<std::uint8_t>                   ctrl_;
+  std::vector<std::pair<std::string_view, T>> slots_;
+  std::size_t                                 size_ = 0;
+};
+
+} // namespace os::hash
@@ -0,0 +1,207 @@
+#pragma once
+
+#include "os/hash.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace os::mem {
+
+// Bump allocator: allocations are a pointer increment into large chunks and are never freed
+// one by one. reset() makes all the memory available again at once, eg when a batch is done,
+// without returning it to the system; release() returns it. Not thread safe, use one per thread.
+class arena {
+public:
+  explicit arena(std::size_t chunk_size = 64UL << 10U)
+      : chunk_size_{std::max<std::size_t>(chunk_size, 64)} {}
+
+  arena(const arena& other) = delete;
+  arena& operator=(const arena& other) = delete;
+
+  // moved from arenas are empty
+  arena(arena&& other) noexcept
+      : chunks_{std::move(other.chunks_)}, chunk_size_{other.chunk_size_},
+        current_{std::exchange(other.current_, 0)}, used_{std::exchange(other.used_, 0)},
+        cur_{std::exchange(other.cur_, nullptr)}, end_{std::exchange(other.end_, nullptr)} {
+    other.chunks_.clear();
+  }
+
+  // frees this arena's chunks, rather than handing them to `other`
+  arena& operator=(arena&& other) noexcept {
+    if (this == &other) return *this;
+    release();
+    chunks_     = std::move(other.chunks_);
+    chunk_size_ = other.chunk_size_;
+    current_    = std::exchange(other.current_, 0);
+    used_       = std::exchange(other.used_, 0);
+    cur_        = std::exchange(other.cur_, nullptr);
+    end_        = std::exchange(other.end_, nullptr);
+    other.chunks_.clear();
+    return *this;
+  }
+
+  ~arena() = default;
+
+  void* allocate(std::size_t size, std::size_t align = alignof(std::max_align_t)) {
+    auto space = [&] {
+      const auto p = reinterpret_cast<std::uintptr_t>(cur_); // NOLINT
+      return (align - p % align) % align;
+    };
+    if (cur_ == nullptr || space() + size > static_cast<std::size_t>(end_ - cur_)) {
+      next_chunk(size + align);
+    }
+    char* p = cur_ + space(); // NOLINT
+    cur_    = p + size;       // NOLINT
+    used_ += size;
+    return p;
+  }
+
+  char* allocate_chars(std::size_t size) { return static_cast<char*>(allocate(size, 1)); }
+
+  // a copy which stays valid until reset() or release()
+  std::string_view copy(std::string_view sv) {
+    if (sv.empty()) return {};
+    char* p = allocate_chars(sv.size());
+    std::memcpy(p, sv.data(), sv.size());
+    return {p, sv.size()};
+  }
+
+  // invalidates all allocations, keeps the chunks for reuse
+  void reset() {
+    current_ = 0;
+    used_    = 0;
+    if (chunks_.empty()) return;
+    cur_ = chunks_[0].data.get();
+    end_ = cur_ + chunks_[0].size; // NOLINT
+  }
+
+  // invalidates all allocations and frees the chunks
+  void release() {
+    chunks_.clear();
+    current_ = 0;
+    used_    = 0;
+    cur_     = nullptr;
+    end_     = nullptr;
+  }
+
+  [[nodiscard]] std::size_t bytes_used() const { return used_; } // requested, without padding
+  [[nodiscard]] std::size_t capacity() const {
+    std::size_t total = 0;
+    for (const auto& c: chunks_) total += c.size;
+    return total;
+  }
+
+private:
+  struct chunk {
+    std::unique_ptr<char[]> data; // NOLINT
+    std::size_t             size;
+  };
+
+  // reuse the chunks after a reset() first, then allocate; oversized requests get their own
+  void next_chunk(std::size_t min_size) {
+    while (cur_ != nullptr && current_ + 1 < chunks_.size()) {
+      ++current_;
+      if (chunks_[current_].size >= min_size) {
+        cur_ = chunks_[current_].data.get();
+        end_ = cur_ + chunks_[current_].size; // NOLINT
+        return;
+      }
+    }
+    const std::size_t size = std::max(chunk_size_, min_size);
+    chunks_.push_back({std::make_unique<char[]>(size), size}); // NOLINT
+    current_ = chunks_.size() - 1;
+    cur_     = chunks_.back().data.get();
+    end_     = cur_ + size; // NOLINT
+  }
+
+  std::vector<chunk> chunks_;
+  std::size_t        chunk_size_;
+  std::size_t        current_ = 0; // index of the chunk cur_ points into
+  std::size_t        used_    = 0;
+  char*              cur_     = nullptr;
+  char*              end_     = nullptr;
+};
+
+// Maps strings to dense ids 0, 1, 2, ... in order of first appearance. Each distinct string is
+// stored once, in an arena, so str(id) views stay valid until clear(). The table is open
+// addressing with linear probing over (hash tag, id) pairs, so a lookup is usually one cache
+// line plus one string compare.
+class interner {
+public:
+  using id_type = std::uint32_t;
+
+  explicit interner(std::size_t chunk_size = 64UL << 10U) : strings_arena_{chunk_size} {}
+
+  id_type intern(std::string_view s) {
+    if (2 * (strings_.size() + 1) > slots_.size()) grow();
+    const std::uint64_t h    = hash::bytes(s);
+    const auto          tag  = static_cast<std::uint32_t>(h >> 32U);
+    const std::size_t   mask = slots_.size() - 1;
+    for (std::size_t i = h & mask;; i = (i + 1) & mask) {
+      slot& sl = slots_[i];
+      if (sl.id == empty) {
+        if (strings_.size() == empty) throw std::length_error("interner: too many strings");
+        sl = {tag, static_cast<id_type>(strings_.size())};
+        strings_.push_back(strings_arena_.copy(s));
+        return sl.id;
+      }
+      if (sl.tag == tag && strings_[sl.id] == s) return sl.id;
+    }
+  }
+
+  [[nodiscard]] std::optional<id_type> find(std::string_view s) const {
+    if (slots_.empty()) return std::nullopt;
+    const std::uint64_t h    = hash::bytes(s);
+    const auto          tag  = static_cast<std::uint32_t>(h >> 32U);
+    const std::size_t   mask = slots_.size() - 1;
+    for (std::size_t i = h & mask;; i = (i + 1) & mask) {
+      const slot& sl = slots_[i];
+      if (sl.id == empty) return std::nullopt;
+      if (sl.tag == tag && strings_[sl.id] == s) return sl.id;
+    }
+  }
+
+  [[nodiscard]] std::string_view str(id_type id) const { return strings_[id]; }
+  [[nodiscard]] std::size_t      size() const { return strings_.size(); }
+
+  // forgets all strings, keeps the memory for the next batch
+  void clear() {
+    std::fill(slots_.begin(), slots_.end(), slot{});
+    strings_.clear();
+    strings_arena_.reset();
+  }
+
+private:
+  static constexpr id_type empty = ~id_type{0};
+
+  struct slot {
+    std::uint32_t tag = 0; // high bits of the hash
+    id_type       id  = empty;
+  };
+
+  void grow() {
+    std::vector<slot> bigger(std::max<std::size_t>(64, 2 * slots_.size()));
+    const std::size_t mask = bigger.size() - 1;
+    for (id_type id = 0; id != strings_.size(); ++id) {
+      const std::uint64_t h = hash::bytes(strings_[id]);
+      std::size_t         i = h & mask;
+      while (bigger[i].id != empty) i = (i + 1) & mask;
+      bigger[i] = {static_cast<std::uint32_t>(h >> 32U), id};
+    }
+    slots_.swap(bigger);
+  }
+
+  std::vector<slot>             slots_;
+  std::vector<std::string_view> strings_;
+  arena                         strings_arena_;
+};
+
+} // namespace os::mem
@@ -0,0 +1,37 @@
+#pragma once
+
+// runtime selection of SIMD kernels
+//
+// Kernels are compiled with per-function target attributes, so the library stays header-only
+// and the binary still runs on baseline x86-64. Callers check `os::simd::level()` once and then
+// call the widest kernel available. Define OS_NO_SIMD to force the generic code paths.
+
+#if !defined(OS_NO_SIMD) && defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define OS_SIMD_X86 1
+#include <immintrin.h>
+#define OS_TARGET_SSE42 __attribute__((target("sse4.2,popcnt")))
+#define OS_TARGET_AVX2  __attribute__((target("avx2,bmi,bmi2,popcnt")))
+#else
+#define OS_SIMD_X86 0
+#endif
+
+namespace os::simd {
+
+enum class isa { generic = 0, sse42 = 1, avx2 = 2 };
+
+inline isa detect() noexcept {
+#if OS_SIMD_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi2")) return isa::avx2;
+  if (__builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt")) return isa::sse42;
+#endif
+  return isa::generic;
+}
+
+// detected once, then a plain load
+inline isa level() noexcept {
+  static const isa detected = detect();
+  return detected;
+}
+
+} // namespace os::simd
@@ -1,15 +1,24 @@
 #pragma once
 
+#include "os/hash.hpp"
+#include "os/mem.hpp"
+#include "os/simd.hpp"
+#include "os/string_builder.hpp"
+
 #include <algorithm>
+#include <array>
 #include <cassert>
 #include <cctype>
 #include <charconv>
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
+#include <initializer_list>
 #include <iostream>
+#include <iterator>
 #include <limits>
 #include <list>
+#include <memory>
 #include <optional>
 #include <set>
 #include <sstream>
@@ -17,6 +26,8 @@
 #include <string>
 #include <string_view>
 #include <system_error>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 namespace os::str {
@@ -40,30 +51,319 @@ inline constexpr std::string_view spacechars() { return " \t\n\r\v\f"; }
 
 inline constexpr bool isalphanum(char c) { return isalpha(c) || isnumeric(c) || isspace(c); }
 
+// only letters change, everything else, including bytes >= 0x80, is returned as is
 inline constexpr char tolower(char c) {
   constexpr auto offset = 'a' - 'A';
-  static_assert(offset % 2 == 0); // it's 32 == 0x20 == 1 << 5  in ASCII
-  return c | offset;              //  NOLINT  - ignore warnings because < 128
+  static_assert(offset == 0x20); // upper and lower case differ in one bit in ASCII
+  return c >= 'A' && c <= 'Z' ? static_cast<char>(c | offset) : c; // NOLINT
 }
 
-inline constexpr char toupper(char c) { return c & ~('a' - 'A'); } //  NOLINT  - ignore warnings
+inline constexpr char toupper(char c) {
+  return c >= 'a' && c <= 'z' ? static_cast<char>(c & ~('a' - 'A')) : c; // NOLINT
+}
 
 } // namespace ascii
 
-inline std::string lpad(const std::string& s, size_t size) {
-  return (s.size() < size) ? std::string(size - s.size(), ' ') + s : s;
+// 256 bit character class, typically built at compile time from one of the ascii predicates:
+//   constexpr auto word = charset::from(ascii::isalpha);
+// Also carries the nibble lookup tables for classifying 16/32 bytes per instruction with
+// pshufb: byte c is a member iff lo[c & 0xF] & hi[c >> 4] != 0. Each distinct "row" of the
+// 16x16 membership matrix needs one bit, so sets with more than 8 distinct rows (rare) are
+// classified by the scalar bitmap instead.
+class charset {
+public:
+  constexpr charset() = default;
+
+  template <typename UnaryPredicate>
+  static constexpr charset from(const UnaryPredicate& pred) {
+    charset cs;
+    for (unsigned c = 0; c != 256; ++c)
+      if (pred(static_cast<char>(c))) cs.bits_[c / 64] |= std::uint64_t{1} << (c % 64); // NOLINT
+    cs.build_nibble_tables();
+    return cs;
+  }
+
+  static constexpr charset of(std::string_view chars) {
+    charset cs;
+    for (char c: chars) {
+      const auto uc = static_cast<unsigned char>(c);
+      cs.bits_[uc / 64] |= std::uint64_t{1} << (uc % 64); // NOLINT
+    }
+    cs.build_nibble_tables();
+    return cs;
+  }
+
+  [[nodiscard]] constexpr bool contains(char c) const {
+    const auto uc = static_cast<unsigned char>(c);
+    return ((bits_[uc / 64] >> (uc % 64)) & 1U) != 0; // NOLINT
+  }
+
+  // so a charset can be used wherever an ascii:: predicate is accepted
+  constexpr bool operator()(char c) const { return contains(c); }
+
+  constexpr charset operator~() const {
+    charset cs;
+    for (std::size_t i = 0; i != bits_.size(); ++i) cs.bits_[i] = ~bits_[i]; // NOLINT
+    cs.build_nibble_tables();
+    return cs;
+  }
+
+  constexpr charset operator|(const charset& other) const {
+    charset cs;
+    for (std::size_t i = 0; i != bits_.size(); ++i)
+      cs.bits_[i] = bits_[i] | other.bits_[i]; // NOLINT
+    cs.build_nibble_tables();
+    return cs;
+  }
+
+  [[nodiscard]] constexpr bool      simd_classifiable() const { return simd_; }
+  [[nodiscard]] const std::uint8_t* nibble_lo() const { return lo_.data(); }
+  [[nodiscard]] const std::uint8_t* nibble_hi() const { return hi_.data(); }
+
+private:
+  constexpr void build_nibble_tables() {
+    std::array<std::uint16_t, 16> rows{};
+    for (unsigned c = 0; c != 256; ++c)
+      if (contains(static_cast<char>(c)))
+        rows[c >> 4U] |= static_cast<std::uint16_t>(1U << (c & 0xFU)); // NOLINT
+
+    std::array<std::uint16_t, 8> classes{};
+    std::size_t                  num_classes = 0;
+    lo_                                      = {};
+    hi_                                      = {};
+    for (unsigned h = 0; h != 16; ++h) {
+      if (rows[h] == 0) continue; // NOLINT
+      std::size_t cls = 0;
+      while (cls != num_classes && classes[cls] != rows[h]) ++cls; // NOLINT
+      if (cls == num_classes) {
+        if (num_classes == classes.size()) {
+          simd_ = false;
+          return;
+        }
+        classes[num_classes++] = rows[h]; // NOLINT
+      }
+      hi_[h] = static_cast<std::uint8_t>(1U << cls); // NOLINT
+    }
+    for (unsigned l = 0; l != 16; ++l)
+      for (std::size_t cls = 0; cls != num_classes; ++cls)
+        if ((classes[cls] >> l) & 1U) lo_[l] |= static_cast<std::uint8_t>(1U << cls); // NOLINT
+    simd_ = true;
+  }
+
+  std::array<std::uint64_t, 4> bits_{};
+  std::array<std::uint8_t, 16> lo_{};
+  std::array<std::uint8_t, 16> hi_{};
+  bool                         simd_ = true;
+};
+
+namespace charsets {
+inline constexpr charset alpha = charset::from(ascii::isalpha);
+inline constexpr charset digit = charset::from(ascii::isdigit);
+inline constexpr charset space = charset::from(ascii::isspace);
+} // namespace charsets
+
+namespace detail {
+
+// bit i of the result is set iff p[i] is a member of `cs`. reads exactly 64 bytes
+using classify64_fn = std::uint64_t (*)(const charset& cs, const char* p);
+
+inline std::uint64_t classify64_generic(const charset& cs, const char* p) {
+  std::uint64_t mask = 0;
+  for (unsigned i = 0; i != 64; ++i)
+    mask |= static_cast<std::uint64_t>(cs.contains(p[i])) << i; // NOLINT
+  return mask;
+}
+
+#if OS_SIMD_X86
+OS_TARGET_SSE42 inline std::uint64_t classify64_sse42(const charset& cs, const char* p) {
+  const auto*   lo_ptr = reinterpret_cast<const __m128i*>(cs.nibble_lo()); // NOLINT
+  const auto*   hi_ptr = reinterpret_cast<const __m128i*>(cs.nibble_hi()); // NOLINT
+  const __m128i lo_tbl = _mm_loadu_si128(lo_ptr);
+  const __m128i hi_tbl = _mm_loadu_si128(hi_ptr);
+  const __m128i nibble = _mm_set1_epi8(0x0F);
+  std::uint64_t mask   = 0;
+  for (unsigned i = 0; i != 4; ++i) {
+    const __m128i v  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16 * i)); // NOLINT
+    const __m128i lo = _mm_shuffle_epi8(lo_tbl, _mm_and_si128(v, nibble));
+    const __m128i hi = _mm_shuffle_epi8(hi_tbl, _mm_and_si128(_mm_srli_epi16(v, 4), nibble));
+    const __m128i out = _mm_cmpeq_epi8(_mm_and_si128(lo, hi), _mm_setzero_si128());
+    mask |= std::uint64_t{static_cast<std::uint16_t>(~_mm_movemask_epi8(out))} << (16 * i);
+  }
+  return mask;
 }
 
-inline std::string rpad(const std::string& s, size_t size) {
-  return (s.size() < size) ? s + std::string(size - s.size(), ' ') : s;
+OS_TARGET_AVX2 inline std::uint64_t classify64_avx2(const charset& cs, const char* p) {
+  const auto*   lo_ptr = reinterpret_cast<const __m128i*>(cs.nibble_lo()); // NOLINT
+  const auto*   hi_ptr = reinterpret_cast<const __m128i*>(cs.nibble_hi()); // NOLINT
+  const __m256i lo_tbl = _mm256_broadcastsi128_si256(_mm_loadu_si128(lo_ptr));
+  const __m256i hi_tbl = _mm256_broadcastsi128_si256(_mm_loadu_si128(hi_ptr));
+  const __m256i nibble = _mm256_set1_epi8(0x0F);
+  std::uint64_t mask   = 0;
+  for (unsigned i = 0; i != 2; ++i) {
+    const __m256i v  = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32 * i)); // NOLINT
+    const __m256i lo = _mm256_shuffle_epi8(lo_tbl, _mm256_and_si256(v, nibble));
+    const __m256i hi =
+        _mm256_shuffle_epi8(hi_tbl, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble));
+    const __m256i out = _mm256_cmpeq_epi8(_mm256_and_si256(lo, hi), _mm256_setzero_si256());
+    mask |= std::uint64_t{static_cast<std::uint32_t>(~_mm256_movemask_epi8(out))} << (32 * i);
+  }
+  return mask;
 }
+#endif // OS_SIMD_X86
 
-inline void tolower(std::string& s) {
-  std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return std::tolower(c); });
+inline classify64_fn classifier([[maybe_unused]] const charset& cs) {
+#if OS_SIMD_X86
+  if (cs.simd_classifiable()) {
+    switch (simd::level()) {
+    case simd::isa::avx2: return classify64_avx2;
+    case simd::isa::sse42: return classify64_sse42;
+    case simd::isa::generic: break;
+    }
+  }
+#endif
+  return classify64_generic;
 }
 
-inline void toupper(std::string& s) {
-  std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return std::toupper(c); });
+// classify a block of less than 64 bytes. bits beyond `len` are clear
+inline std::uint64_t classify_tail(classify64_fn classify, const charset& cs, const char* p,
+                                   std::size_t len) {
+  std::array<char, 64> block{};
+  std::memcpy(block.data(), p, len);
+  return classify(cs, block.data()) & ((std::uint64_t{1} << len) - 1);
+}
+
+} // namespace detail
+
+inline std::string lpad(std::string_view s, std::size_t size) {
+  return string_builder{}.lpad(s, size).str();
+}
+
+inline std::string rpad(std::string_view s, std::size_t size) {
+  return string_builder{}.rpad(s, size).str();
+}
+
+namespace detail {
+
+// Case conversion flips bit 0x20 of the bytes in [first, last], ie 'A'..'Z' or 'a'..'z'; the
+// SIMD versions select them with two signed compares, which bytes >= 0x80 never pass.
+// `src` may equal `dst`.
+inline void change_case_generic(const char* src, std::size_t n, char* dst, char first,
+                                char last) {
+  for (std::size_t i = 0; i != n; ++i) {
+    const char c = src[i];                                             // NOLINT
+    dst[i] = c >= first && c <= last ? static_cast<char>(c ^ 0x20) : c; // NOLINT
+  }
+}
+
+inline bool iequal_generic(const char* a, const char* b, std::size_t n) {
+  for (std::size_t i = 0; i != n; ++i)
+    if (ascii::tolower(a[i]) != ascii::tolower(b[i])) return false; // NOLINT
+  return true;
+}
+
+#if OS_SIMD_X86
+OS_TARGET_SSE42 inline __m128i change_case_sse42(__m128i v, char first, char last) {
+  const __m128i in = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(static_cast<char>(first - 1))),
+                                   _mm_cmplt_epi8(v, _mm_set1_epi8(static_cast<char>(last + 1))));
+  return _mm_xor_si128(v, _mm_and_si128(in, _mm_set1_epi8(0x20)));
+}
+
+OS_TARGET_SSE42 inline void change_case_sse42(const char* src, std::size_t n, char* dst,
+                                              char first, char last) {
+  std::size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)); // NOLINT
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),                        // NOLINT
+                     change_case_sse42(v, first, last));
+  }
+  change_case_generic(src + i, n - i, dst + i, first, last); // NOLINT
+}
+
+OS_TARGET_SSE42 inline bool iequal_sse42(const char* a, const char* b, std::size_t n) {
+  std::size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)); // NOLINT
+    const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)); // NOLINT
+    const __m128i eq =
+        _mm_cmpeq_epi8(change_case_sse42(va, 'A', 'Z'), change_case_sse42(vb, 'A', 'Z'));
+    if (_mm_movemask_epi8(eq) != 0xFFFF) return false;
+  }
+  return iequal_generic(a + i, b + i, n - i); // NOLINT
+}
+
+OS_TARGET_AVX2 inline __m256i change_case_avx2(__m256i v, char first, char last) {
+  const __m256i in =
+      _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8(static_cast<char>(first - 1))),
+                       _mm256_cmpgt_epi8(_mm256_set1_epi8(static_cast<char>(last + 1)), v));
+  return _mm256_xor_si256(v, _mm256_and_si256(in, _mm256_set1_epi8(0x20)));
+}
+
+OS_TARGET_AVX2 inline void change_case_avx2(const char* src, std::size_t n, char* dst,
+                                            char first, char last) {
+  std::size_t i = 0;
+  for (; i + 32 <= n; i += 32) {
+    const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i)); // NOLINT
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i),                        // NOLINT
+                        change_case_avx2(v, first, last));
+  }
+  change_case_generic(src + i, n - i, dst + i, first, last); // NOLINT
+}
+
+OS_TARGET_AVX2 inline bool iequal_avx2(const char* a, const char* b, std::size_t n) {
+  std::size_t i = 0;
+  for (; i + 32 <= n; i += 32) {
+    const __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)); // NOLINT
+    const __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i)); // NOLINT
+    const __m256i eq =
+        _mm256_cmpeq_epi8(change_case_avx2(va, 'A', 'Z'), change_case_avx2(vb, 'A', 'Z'));
+    if (_mm256_movemask_epi8(eq) != -1) return false;
+  }
+  return iequal_generic(a + i, b + i, n - i); // NOLINT
+}
+#endif // OS_SIMD_X86
+
+inline void change_case(const char* src, std::size_t n, char* dst, char first, char last) {
+#if OS_SIMD_X86
+  switch (simd::level()) {
+  case simd::isa::avx2: return change_case_avx2(src, n, dst, first, last);
+  case simd::isa::sse42: return change_case_sse42(src, n, dst, first, last);
+  case simd::isa::generic: break;
+  }
+#endif
+  change_case_generic(src, n, dst, first, last);
+}
+
+inline bool iequal(const char* a, const char* b, std::size_t n) {
+#if OS_SIMD_X86
+  switch (simd::level()) {
+  case simd::isa::avx2: return iequal_avx2(a, b, n);
+  case simd::isa::sse42: return iequal_sse42(a, b, n);
+  case simd::isa::generic: break;
+  }
+#endif
+  return iequal_generic(a, b, n);
+}
+
+} // namespace detail
+
+// ASCII case conversion of `src` into `dst`, which has room for src.size() characters and may
+// be src.data(). Bytes other than letters, eg of UTF-8 sequences, are copied unchanged, and
+// the result does not depend on the locale. 16 or 32 bytes per step where SIMD is available.
+inline void tolower(std::string_view src, char* dst) {
+  detail::change_case(src.data(), src.size(), dst, 'A', 'Z');
+}
+
+inline void toupper(std::string_view src, char* dst) {
+  detail::change_case(src.data(), src.size(), dst, 'a', 'z');
+}
+
+inline void tolower(std::string& s) { tolower(s, s.data()); }
+
+inline void toupper(std::string& s) { toupper(s, s.data()); }
+
+// ASCII case insensitive comparison
+inline bool iequals(std::string_view a, std::string_view b) {
+  return a.size() == b.size() && detail::iequal(a.data(), b.data(), a.size());
 }
 
 template <typename...>
@@ -135,7 +435,305 @@ constexpr ReturnType parse_nonnegative_int(const char* begin, const char* end,
 }
 
 
-// must set a utf8 locale before calling this
+// Non throwing alternative to parse<T>, for every integral and floating point type.
+// Takes (ptr, len) without needing a NUL, never allocates, and is locale and errno free.
+// Integers are base 10 only (parse<T> also accepts 0x.. and 0.. prefixes via strtol).
+//   if (auto r = os::str::try_parse<int>(field.data(), field.size())) use(r.value);
+//   else if (r.ec == std::errc::result_out_of_range) ...
+template <typename T>
+struct parse_result {
+  T         value{};
+  std::errc ec = std::errc::invalid_argument;
+
+  [[nodiscard]] bool has_value() const noexcept { return ec == std::errc(); }
+  [[nodiscard]] T    value_or(T fallback) const noexcept { return has_value() ? value : fallback; }
+
+  explicit operator bool() const noexcept { return has_value(); }
+};
+
+// Bulk parsing of a delimited buffer of numbers (eg one column of a CSV, or a file with a
+// number per line) into a vector, without exceptions, errno or NUL terminators.
+// Fields which don't parse are recorded in a status bitmap and left as T{} in the output.
+
+// one bit per field, set when that field failed to parse
+class column_status {
+public:
+  [[nodiscard]] bool failed(std::size_t field) const {
+    return ((bits_[field / 64] >> (field % 64)) & 1U) != 0; // NOLINT
+  }
+
+  [[nodiscard]] bool        ok(std::size_t field) const { return !failed(field); }
+  [[nodiscard]] bool        ok() const { return errors_ == 0; }
+  [[nodiscard]] std::size_t errors() const { return errors_; }
+  [[nodiscard]] std::size_t size() const { return size_; }
+
+  [[nodiscard]] const std::vector<std::uint64_t>& bits() const { return bits_; }
+
+  void reset(std::size_t fields) {
+    bits_.assign((fields + 63) / 64, 0);
+    size_   = fields;
+    errors_ = 0;
+  }
+
+  void push_back(bool failed) {
+    if (size_ % 64 == 0) bits_.push_back(0);
+    bits_.back() |= std::uint64_t{failed} << (size_ % 64);
+    errors_ += static_cast<std::size_t>(failed);
+    ++size_;
+  }
+
+private:
+  std::vector<std::uint64_t> bits_;
+  std::size_t                size_   = 0;
+  std::size_t                errors_ = 0;
+};
+
+namespace detail {
+
+// SWAR: 8 ascii digits in one uint64_t, first digit in the low byte. after fast_float / simdjson
+inline std::uint64_t load_eight_chars(const char* p) {
+  std::uint64_t chunk{};
+  std::memcpy(&chunk, p, sizeof(chunk));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  chunk = __builtin_bswap64(chunk);
+#endif
+  return chunk;
+}
+
+inline bool is_eight_digits(std::uint64_t chunk) {
+  return (((chunk + 0x4646464646464646) | (chunk - 0x3030303030303030)) & 0x8080808080808080) == 0;
+}
+
+inline std::uint64_t parse_eight_digits(std::uint64_t chunk) {
+  constexpr std::uint64_t mask = 0x000000FF000000FF;
+  constexpr std::uint64_t mul1 = 0x000F424000000064; // 100 + (1000000ULL << 32)
+  constexpr std::uint64_t mul2 = 0x0000271000000001; // 1 + (10000ULL << 32)
+  chunk -= 0x3030303030303030;
+  chunk = (chunk * 10) + (chunk >> 8); // NOLINT
+  return (((chunk & mask) * mul1) + (((chunk >> 16) & mask) * mul2)) >> 32; // NOLINT
+}
+
+// [first, last) must be exactly one base 10 integer, with an optional sign. No locale, no
+// errno, no NUL needed. std::errc{} on success, else invalid_argument or result_out_of_range
+template <typename T>
+std::errc parse_integer(const char* first, const char* last, T& value) noexcept {
+  static_assert(std::is_integral_v<T> && sizeof(T) <= sizeof(std::uint64_t));
+  bool negative = false;
+  if (first != last && (*first == '-' || *first == '+')) negative = *first++ == '-';
+  if (first == last) return std::errc::invalid_argument;
+
+  std::uint64_t acc      = 0;
+  bool          overflow = false;
+  while (last - first >= 8) { // NOLINT
+    const std::uint64_t chunk = load_eight_chars(first);
+    if (!is_eight_digits(chunk)) break;
+    overflow |= __builtin_mul_overflow(acc, std::uint64_t{100'000'000}, &acc);
+    overflow |= __builtin_add_overflow(acc, parse_eight_digits(chunk), &acc);
+    first += 8; // NOLINT
+  }
+  for (; first != last; ++first) {
+    const auto digit = static_cast<unsigned char>(*first - '0');
+    if (digit > 9) return std::errc::invalid_argument;
+    overflow |= __builtin_mul_overflow(acc, std::uint64_t{10}, &acc);
+    overflow |= __builtin_add_overflow(acc, std::uint64_t{digit}, &acc);
+  }
+  if (overflow) return std::errc::result_out_of_range;
+
+  if constexpr (std::is_signed_v<T>) {
+    const auto max = static_cast<std::uint64_t>(std::numeric_limits<T>::max());
+    if (acc > max + static_cast<std::uint64_t>(negative)) return std::errc::result_out_of_range;
+    value = negative ? static_cast<T>(0 - acc) : static_cast<T>(acc);
+  } else {
+    if (negative && acc != 0) return std::errc::result_out_of_range;
+    if (acc > std::numeric_limits<T>::max()) return std::errc::result_out_of_range;
+    value = static_cast<T>(acc);
+  }
+  return std::errc{};
+}
+
+template <typename T>
+std::errc parse_floating(const char* first, const char* last, T& value) noexcept {
+  if (first != last && *first == '+') { // from_chars rejects the '+', but would take "+-5"
+    if (++first != last && *first == '-') return std::errc::invalid_argument;
+  }
+  auto [ptr, ec] = std::from_chars(first, last, value);
+  if (ec == std::errc() && ptr != last) return std::errc::invalid_argument;
+  return ec;
+}
+
+template <typename T>
+std::errc parse_field(const char* first, const char* last, T& value) noexcept {
+  std::errc ec{};
+  if constexpr (std::is_floating_point_v<T>)
+    ec = parse_floating(first, last, value);
+  else
+    ec = parse_integer(first, last, value);
+  if (ec != std::errc()) value = T{};
+  return ec;
+}
+
+} // namespace detail
+
+// Parses each `delim` separated field of `buffer` into `out` (which is cleared first). A final
+// delim does not start an extra field, and with '\n' as delim a '\r' before it is ignored.
+// Integers (signed or not) take an 8 digits at a time SWAR path, floats use std::from_chars.
+template <typename T>
+column_status parse_column(std::string_view buffer, std::vector<T>& out, char delim = '\n') {
+  static_assert(std::is_arithmetic_v<T> && !std::is_same_v<T, bool>, "numeric types only");
+  column_status status;
+  out.clear();
+
+  const char*       field = buffer.data();
+  const char* const end   = field + buffer.size(); // NOLINT
+  while (field != end) {
+    const auto  remaining = static_cast<std::size_t>(end - field);
+    const auto* sep       = static_cast<const char*>(std::memchr(field, delim, remaining));
+    const char* last      = sep != nullptr ? sep : end;
+    const char* next      = sep != nullptr ? sep + 1 : end; // NOLINT
+    if (delim == '\n' && last != field && last[-1] == '\r') --last; // NOLINT
+    T value{};
+    status.push_back(detail::parse_field(field, last, value) != std::errc());
+    out.push_back(value);
+    field = next;
+  }
+  return status;
+}
+
+template <typename T>
+parse_result<T> try_parse(const char* str, std::size_t len) noexcept {
+  static_assert(std::is_arithmetic_v<T> && !std::is_same_v<T, bool>, "numeric types only");
+  parse_result<T> result;
+  result.ec = detail::parse_field(str, str + len, result.value); // NOLINT
+  return result;
+}
+
+template <typename T>
+parse_result<T> try_parse(std::string_view sv) noexcept {
+  return try_parse<T>(sv.data(), sv.size());
+}
+
+// UTF-8 code point counting and validation. Locale independent and thread safe, unlike
+// mb_strlen below.
+
+namespace detail {
+
+// number of UTF-8 continuation bytes (10xxxxxx) in 8 bytes
+inline unsigned continuation_bytes(std::uint64_t word) {
+  return static_cast<unsigned>(__builtin_popcountll(word & ~(word << 1) & 0x8080808080808080));
+}
+
+inline std::size_t utf8_length_generic(const char* p, std::size_t len) {
+  std::size_t count = len;
+  std::size_t i     = 0;
+  for (; i + 8 <= len; i += 8) {
+    std::uint64_t word{};
+    std::memcpy(&word, p + i, sizeof(word)); // NOLINT
+    count -= continuation_bytes(word);
+  }
+  for (; i != len; ++i) count -= static_cast<std::size_t>((p[i] & 0xC0) == 0x80); // NOLINT
+  return count;
+}
+
+#if OS_SIMD_X86
+// continuation bytes are exactly those < -64 as int8
+OS_TARGET_SSE42 inline std::size_t utf8_length_sse42(const char* p, std::size_t len) {
+  const __m128i limit = _mm_set1_epi8(-65);
+  std::size_t   count = 0;
+  std::size_t   i     = 0;
+  for (; i + 16 <= len; i += 16) {
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i)); // NOLINT
+    count += static_cast<std::size_t>(__builtin_popcount(
+        static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpgt_epi8(v, limit)))));
+  }
+  return count + utf8_length_generic(p + i, len - i); // NOLINT
+}
+
+OS_TARGET_AVX2 inline std::size_t utf8_length_avx2(const char* p, std::size_t len) {
+  const __m256i limit = _mm256_set1_epi8(-65);
+  std::size_t   count = 0;
+  std::size_t   i     = 0;
+  for (; i + 32 <= len; i += 32) {
+    const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i)); // NOLINT
+    count += static_cast<std::size_t>(__builtin_popcount(
+        static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpgt_epi8(v, limit)))));
+  }
+  return count + utf8_length_generic(p + i, len - i); // NOLINT
+}
+#endif // OS_SIMD_X86
+
+// Validates while counting. Runs of ASCII are skipped 16 bytes at a time, everything else is
+// decoded per the rules of RFC 3629: no overlong forms, no surrogates, nothing above U+10FFFF.
+inline std::optional<std::size_t> utf8_length_checked(const unsigned char* p, std::size_t len) {
+  std::size_t count = 0;
+  std::size_t i     = 0;
+  while (i != len) {
+    if (i + 16 <= len) {
+      std::uint64_t lo{};
+      std::uint64_t hi{};
+      std::memcpy(&lo, p + i, sizeof(lo));     // NOLINT
+      std::memcpy(&hi, p + i + 8, sizeof(hi)); // NOLINT
+      if (((lo | hi) & 0x8080808080808080) == 0) {
+        i += 16;
+        count += 16;
+        continue;
+      }
+    }
+    const unsigned lead = p[i]; // NOLINT
+    std::size_t    size = 0;
+    unsigned       min  = 0x80; // allowed range of the second byte
+    unsigned       max  = 0xBF;
+    if (lead < 0x80) {
+      size = 1;
+    } else if (lead >= 0xC2 && lead <= 0xDF) {
+      size = 2;
+    } else if (lead >= 0xE0 && lead <= 0xEF) {
+      size = 3;
+      if (lead == 0xE0) min = 0xA0; // overlong
+      if (lead == 0xED) max = 0x9F; // surrogates
+    } else if (lead >= 0xF0 && lead <= 0xF4) {
+      size = 4;
+      if (lead == 0xF0) min = 0x90; // overlong
+      if (lead == 0xF4) max = 0x8F; // > U+10FFFF
+    } else {
+      return std::nullopt;
+    }
+    if (size > len - i) return std::nullopt;
+    if (size > 1) {
+      if (p[i + 1] < min || p[i + 1] > max) return std::nullopt; // NOLINT
+      for (std::size_t k = 2; k < size; ++k)
+        if ((p[i + k] & 0xC0U) != 0x80) return std::nullopt; // NOLINT
+    }
+    i += size;
+    ++count;
+  }
+  return count;
+}
+
+} // namespace detail
+
+// number of code points, assuming `s` is valid UTF-8 (it counts the bytes which are not
+// continuation bytes). no validation, so invalid input gives a meaningless but safe result
+inline std::size_t utf8_length(std::string_view s) noexcept {
+#if OS_SIMD_X86
+  switch (simd::level()) {
+  case simd::isa::avx2: return detail::utf8_length_avx2(s.data(), s.size());
+  case simd::isa::sse42: return detail::utf8_length_sse42(s.data(), s.size());
+  case simd::isa::generic: break;
+  }
+#endif
+  return detail::utf8_length_generic(s.data(), s.size());
+}
+
+// number of code points, or nullopt if `s` is not valid UTF-8
+inline std::optional<std::size_t> utf8_length_checked(std::string_view s) noexcept {
+  return detail::utf8_length_checked(reinterpret_cast<const unsigned char*>(s.data()), // NOLINT
+                                     s.size());
+}
+
+inline bool utf8_valid(std::string_view s) noexcept { return utf8_length_checked(s).has_value(); }
+
+// must set a utf8 locale before calling this. see utf8_length_checked() for a locale
+// independent and thread safe alternative
 inline std::size_t mb_strlen(const std::string_view s) {
   std::size_t result = 0;
   const char* ptr    = s.data();
@@ -151,41 +749,169 @@ inline std::size_t mb_strlen(const std::string_view s) {
   return result;
 }
 
-inline void ltrim(std::string& s, std::string_view delims = " \v\t\n\r") {
+namespace detail {
+
+// Trimming with a charset. Most fields have no or a few bytes to trim, so the first 16 from
+// the end are tested one by one with `contains`, the scalar membership test: for the default
+// sets a dedicated low_set_contains, otherwise a lookup in the set. Longer runs are classified
+// 64 bytes at a time.
+
+// index of the first byte of [p, p + n) whose membership of `cs` is `member`, or n
+template <typename Contains>
+std::size_t find_first(const charset& cs, const Contains& contains, const char* p, std::size_t n,
+                       bool member) {
+  std::size_t i = 0;
+  for (; i != n && i != 16; ++i)
+    if (contains(p[i]) == member) return i; // NOLINT
+  const classify64_fn classify = classifier(cs);
+  for (; i + 64 <= n; i += 64) {
+    const std::uint64_t m = classify(cs, p + i) ^ (member ? 0 : ~std::uint64_t{0}); // NOLINT
+    if (m != 0) return i + static_cast<std::size_t>(__builtin_ctzll(m));
+  }
+  for (; i != n; ++i)
+    if (contains(p[i]) == member) return i; // NOLINT
+  return n;
+}
+
+// one past the last such byte, or 0
+template <typename Contains>
+std::size_t find_last_end(const charset& cs, const Contains& contains, const char* p,
+                          std::size_t n, bool member) {
+  std::size_t i = n;
+  for (; i != 0 && n - i != 16; --i)
+    if (contains(p[i - 1]) == member) return i; // NOLINT
+  const classify64_fn classify = classifier(cs);
+  for (; i >= 64; i -= 64) {
+    const std::uint64_t m = classify(cs, p + i - 64) ^ (member ? 0 : ~std::uint64_t{0}); // NOLINT
+    if (m != 0) return i - static_cast<std::size_t>(__builtin_clzll(m));
+  }
+  for (; i != 0; --i)
+    if (contains(p[i - 1]) == member) return i; // NOLINT
+  return 0;
+}
+
+inline std::size_t find_first(const charset& cs, const char* p, std::size_t n, bool member) {
+  return find_first(cs, [&cs](char c) { return cs.contains(c); }, p, n, member);
+}
+
+inline std::size_t find_last_end(const charset& cs, const char* p, std::size_t n, bool member) {
+  return find_last_end(cs, [&cs](char c) { return cs.contains(c); }, p, n, member);
+}
+
+// membership of a set of bytes below 64, given as a mask: one compare and one bit test. A type
+// per set, so that the test is inlined into find_first() and find_last_end()
+template <std::uint64_t Mask>
+struct low_set_contains {
+  constexpr bool operator()(char c) const {
+    const auto u = static_cast<unsigned char>(c);
+    return u < 64 && ((Mask >> u) & 1U) != 0;
+  }
+};
+
+constexpr std::uint64_t low_set_mask(std::string_view chars) {
+  std::uint64_t mask = 0;
+  for (const char c: chars) mask |= std::uint64_t{1} << static_cast<unsigned char>(c);
+  return mask;
+}
+
+// the default of the string_view trims, ascii::isspace
+inline constexpr low_set_contains<low_set_mask(ascii::spacechars())> is_space{};
+
+// the default of the std::string trims, which unlike ascii::spacechars() leave '\f' alone
+inline constexpr charset string_trim_chars = charset::of(" \v\t\n\r");
+inline constexpr low_set_contains<low_set_mask(" \v\t\n\r")> is_string_trim_char{};
+
+} // namespace detail
+
+// Trims with a 256 bit set, typically a compile time constant:
+//   constexpr auto quotes = os::str::charset::of("\"' ");
+//   os::str::trim(field, quotes);
+inline void ltrim(std::string& s, const charset& trim_chars) {
+  s.erase(0, detail::find_first(trim_chars, s.data(), s.size(), false));
+}
+
+inline void rtrim(std::string& s, const charset& trim_chars) {
+  s.erase(detail::find_last_end(trim_chars, s.data(), s.size(), false));
+}
+
+// the default " \v\t\n\r"
+inline void ltrim(std::string& s) {
+  s.erase(0, detail::find_first(detail::string_trim_chars, detail::is_string_trim_char, s.data(),
+                                s.size(), false));
+}
+
+inline void rtrim(std::string& s) {
+  s.erase(detail::find_last_end(detail::string_trim_chars, detail::is_string_trim_char, s.data(),
+                                s.size(), false));
+}
+
+inline void ltrim(std::string& s, std::string_view delims) {
   s.erase(0, s.find_first_not_of(delims));
 }
 
-inline void rtrim(std::string& s, std::string_view delims = " \v\t\n\r") {
+inline void rtrim(std::string& s, std::string_view delims) {
   s.erase(s.find_last_not_of(delims) + 1); // npos wraps to zero
 }
 
 // clang-format off
-inline void trim(std::string& s, std::string_view delims = " \v\t\n\r") { ltrim(s, delims); rtrim(s, delims); }
+inline void trim(std::string& s) { rtrim(s); ltrim(s); }
+inline void trim(std::string& s, const charset& trim_chars) { rtrim(s, trim_chars); ltrim(s, trim_chars); }
+inline void trim(std::string& s, std::string_view delims) { rtrim(s, delims); ltrim(s, delims); }
 
-inline std::string ltrim_copy(std::string s, std::string_view delims = " \v\t\n\r") { ltrim(s, delims); return s; }
-inline std::string rtrim_copy(std::string s, std::string_view delims = " \v\t\n\r") { rtrim(s, delims); return s; }
-inline std::string trim_copy(std::string s, std::string_view delims = " \v\t\n\r") { trim(s, delims); return s; }
+inline std::string ltrim_copy(std::string s) { ltrim(s); return s; }
+inline std::string rtrim_copy(std::string s) { rtrim(s); return s; }
+inline std::string trim_copy(std::string s) { trim(s); return s; }
+inline std::string ltrim_copy(std::string s, const charset& trim_chars) { ltrim(s, trim_chars); return s; }
+inline std::string rtrim_copy(std::string s, const charset& trim_chars) { rtrim(s, trim_chars); return s; }
+inline std::string trim_copy(std::string s, const charset& trim_chars) { trim(s, trim_chars); return s; }
+inline std::string ltrim_copy(std::string s, std::string_view delims) { ltrim(s, delims); return s; }
+inline std::string rtrim_copy(std::string s, std::string_view delims) { rtrim(s, delims); return s; }
+inline std::string trim_copy(std::string s, std::string_view delims) { trim(s, delims); return s; }
 
 inline std::string tolower_copy(std::string s) { tolower(s); return s; }
 inline std::string toupper_copy(std::string s) { toupper(s); return s; }
 // clang-format on
 
 // std::string_view equivalents. different implementation, and "_copy" only because cheap
-inline std::string_view ltrim(std::string_view sv,
-                              std::string_view ignore_chars = ascii::spacechars()) {
+// whitespace, as ascii::isspace
+inline std::string_view ltrim(std::string_view sv) {
+  sv.remove_prefix(
+      detail::find_first(charsets::space, detail::is_space, sv.data(), sv.size(), false));
+  return sv;
+}
+
+inline std::string_view rtrim(std::string_view sv) {
+  return sv.substr(
+      0, detail::find_last_end(charsets::space, detail::is_space, sv.data(), sv.size(), false));
+}
+
+inline std::string_view trim(std::string_view sv) { return ltrim(rtrim(sv)); }
+
+inline std::string_view ltrim(std::string_view sv, const charset& trim_chars) {
+  sv.remove_prefix(detail::find_first(trim_chars, sv.data(), sv.size(), false));
+  return sv;
+}
+
+inline std::string_view rtrim(std::string_view sv, const charset& trim_chars) {
+  return sv.substr(0, detail::find_last_end(trim_chars, sv.data(), sv.size(), false));
+}
+
+inline std::string_view trim(std::string_view sv, const charset& trim_chars) {
+  return ltrim(rtrim(sv, trim_chars), trim_chars);
+}
+
+inline std::string_view ltrim(std::string_view sv, std::string_view ignore_chars) {
   sv.remove_prefix(std::min(sv.find_first_not_of(ignore_chars), sv.size()));
   return sv;
 }
 
-inline std::string_view rtrim(std::string_view sv,
-                              std::string_view ignore_chars = ascii::spacechars()) {
+inline std::string_view rtrim(std::string_view sv, std::string_view ignore_chars) {
   auto last = sv.find_last_not_of(ignore_chars);
   if (last != std::string_view::npos) sv.remove_suffix(sv.size() - last - 1);
   return sv;
 }
 
-inline std::string_view trim(std::string_view sv,
-                             std::string_view ignore_chars = ascii::spacechars()) {
+inline std::string_view trim(std::string_view sv, std::string_view ignore_chars) {
   return ltrim(rtrim(sv, ignore_chars), ignore_chars);
 }
 
@@ -209,15 +935,57 @@ std::string_view trim_if(std::string_view sv, const UnaryPredicate& ischar) {
   return ltrim_if(rtrim_if(sv, ischar), ischar);
 }
 
+// charset versions of the above, same results, with the scans of trim
+inline std::string_view ltrim_if(std::string_view sv, const charset& ischar) {
+  const std::size_t first = detail::find_first(ischar, sv.data(), sv.size(), true);
+  if (first != sv.size()) sv.remove_prefix(first);
+  return sv;
+}
+
+inline std::string_view rtrim_if(std::string_view sv, const charset& ischar) {
+  const std::size_t end = detail::find_last_end(ischar, sv.data(), sv.size(), true);
+  if (end != 0) sv.remove_suffix(sv.size() - end);
+  return sv;
+}
+
+inline std::string_view trim_if(std::string_view sv, const charset& ischar) {
+  return ltrim_if(rtrim_if(sv, ischar), ischar);
+}
+
 inline std::optional<std::string> trim_lower(std::string_view word) {
   word = trim_if(word, ascii::isalpha);
-  if (!word.empty()) {
-    std::string output{word};
-    std::transform(output.begin(), output.end(), output.begin(),
-                   [](auto c) { return ascii::tolower(c); });
-    return output; // auto wrapped in std::optional
+  if (word.empty()) return std::nullopt;
+  std::string output(word.size(), '\0');
+  str::tolower(word, output.data());
+  return output; // auto wrapped in std::optional
+}
+
+// As above without a heap allocation per word: the result is written into `a` and stays valid
+// until a.reset(). Empty if `word` is.
+inline std::string_view trim_lower(std::string_view word, mem::arena& a) {
+  word = trim_if(word, ascii::isalpha);
+  if (word.empty()) return {};
+  char* out = a.allocate_chars(word.size());
+  str::tolower(word, out);
+  return {out, word.size()};
+}
+
+// The id of the normalised word in `words`, the same for identical words, or nullopt if
+// `word` is empty. Only the first occurrence of a word is stored.
+inline std::optional<mem::interner::id_type> trim_lower(std::string_view word,
+                                                        mem::interner& words) {
+  word = trim_if(word, ascii::isalpha);
+  if (word.empty()) return std::nullopt;
+  constexpr std::size_t small = 256;
+  char                  buf[small]; // NOLINT
+  std::string           big;
+  char*                 out = buf;
+  if (word.size() > small) {
+    big.resize(word.size());
+    out = big.data();
   }
-  return std::nullopt;
+  str::tolower(word, out);
+  return words.intern({out, word.size()});
 }
 
 template <typename ActionCallback, typename TokenPredicate = decltype(ascii::isalpha)>
@@ -237,40 +1005,371 @@ void for_each_token(std::string_view buffer, const ActionCallback& action,
   }
 }
 
+// Calls `action` with each maximal run of `token_chars` in `buffer`. Unlike for_each_token,
+// no empty tokens are produced and a final token without a trailing separator is included.
+// 64 bytes are classified per step (SIMD where available) and token boundaries are found by
+// bit scanning the resulting masks, so no per byte predicate calls and no allocations.
+template <typename ActionCallback>
+void scan_tokens(std::string_view buffer, const ActionCallback& action,
+                 const charset& token_chars = charsets::alpha) {
+
+  const char* const           base     = buffer.data();
+  const std::size_t           size     = buffer.size();
+  const detail::classify64_fn classify = detail::classifier(token_chars);
+
+  bool        in_token = false;
+  std::size_t start    = 0;
+  for (std::size_t offset = 0; offset < size; offset += 64) {
+    const char*         block   = base + offset; // NOLINT
+    const std::uint64_t members = size - offset >= 64
+                                      ? classify(token_chars, block)
+                                      : detail::classify_tail(classify, token_chars, block,
+                                                              size - offset);
+    // bits where the state flips, starting with the first change from the current state
+    std::uint64_t changes = in_token ? ~members : members;
+    while (changes != 0) {
+      const auto bit = static_cast<unsigned>(__builtin_ctzll(changes));
+      if (in_token)
+        action(std::string_view{base + start, offset + bit - start}); // NOLINT
+      else
+        start = offset + bit;
+      in_token = !in_token;
+      changes  = (in_token ? ~members : members) & (~std::uint64_t{0} << bit);
+    }
+  }
+  if (in_token) action(std::string_view{base + start, size - start}); // NOLINT
+}
+
+// Counts occurrences of words in an os::hash::string_map. Not thread safe: in a parallel scan
+// give each thread its own counter and merge() them at the end. Each distinct word is copied
+// into an arena once, which keeps the keys compared on lookup close together and in cache
+// (rather than scattered over the scanned buffer) and makes the counter independent of it.
+class word_counter {
+public:
+  using count_type = std::uint64_t;
+
+  void add(std::string_view word, count_type n = 1) {
+    total_ += n;
+    *words_.try_emplace(word, [this](std::string_view w) { return keys_.copy(w); }).first += n;
+  }
+
+  void merge(const word_counter& other) {
+    if (&other == this) { // adding while iterating would rehash under the loop
+      words_.for_each([](std::string_view, count_type& n) { n *= 2; });
+      total_ *= 2;
+      return;
+    }
+    words_.reserve(words_.size() + other.size());
+    other.words_.for_each([this](std::string_view w, count_type n) { add(w, n); });
+  }
+
+  [[nodiscard]] count_type count(std::string_view word) const {
+    const count_type* n = words_.find(word);
+    return n != nullptr ? *n : 0;
+  }
+
+  [[nodiscard]] std::size_t size() const { return words_.size(); }  // distinct words
+  [[nodiscard]] count_type  total() const { return total_; }        // all words
+  void                      reserve(std::size_t n) { words_.reserve(n); }
+
+  // fn(word, count) for each distinct word, in no particular order
+  template <typename Fn>
+  void for_each(Fn&& fn) const {
+    words_.for_each(std::forward<Fn>(fn));
+  }
+
+  // the `k` most frequent words, by descending count, ties by word
+  [[nodiscard]] std::vector<std::pair<std::string_view, count_type>> top(std::size_t k) const {
+    std::vector<std::pair<std::string_view, count_type>> all;
+    all.reserve(words_.size());
+    words_.for_each([&](std::string_view w, count_type n) { all.emplace_back(w, n); });
+    k = std::min(k, all.size());
+    std::partial_sort(all.begin(), all.begin() + static_cast<std::ptrdiff_t>(k), all.end(),
+                      [](const auto& a, const auto& b) {
+                        return a.second != b.second ? a.second > b.second : a.first < b.first;
+                      });
+    all.resize(k);
+    return all;
+  }
+
+private:
+  hash::string_map<count_type> words_;
+  mem::arena                   keys_;
+  count_type                   total_ = 0;
+};
+
+// Lazy forward range over the pieces of `sv` between separators. Pieces are views into `sv`,
+// produced on demand, so nothing is allocated. `any_of` splits on each occurrence of any of the
+// separator chars, `exact` on each occurrence of the whole separator string. n separators
+// always give n + 1 pieces, some possibly empty. An empty separator does not split.
+//   for (auto piece: os::str::split(line, ", ")) ...
+//   for (auto&& [i, field]: os::algo::enumerate(os::str::split_any_of(line, ",;"))) ...
+class split_view {
+public:
+  enum class mode { any_of, exact };
+
+  class iterator {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type        = std::string_view;
+    using difference_type   = std::ptrdiff_t;
+    using pointer           = const std::string_view*;
+    using reference         = const std::string_view&;
+
+    iterator() = default;
+
+    reference operator*() const { return piece_; }
+    pointer   operator->() const { return &piece_; }
+
+    iterator& operator++() {
+      if (next_ == std::string_view::npos)
+        view_ = nullptr; // now equal to end()
+      else
+        read_piece(next_);
+      return *this;
+    }
+
+    iterator operator++(int) {
+      iterator old = *this;
+      ++*this;
+      return old;
+    }
+
+    bool operator==(const iterator& other) const {
+      return view_ == other.view_ && (view_ == nullptr || next_ == other.next_);
+    }
+    bool operator!=(const iterator& other) const { return !(*this == other); }
+
+  private:
+    friend class split_view;
+
+    explicit iterator(const split_view* view) : view_{view} { read_piece(0); }
+
+    void read_piece(std::size_t start) {
+      const auto        sv  = view_->sv_;
+      const std::size_t end = view_->find_separator(start);
+      if (end == std::string_view::npos) {
+        piece_ = sv.substr(start);
+        next_  = std::string_view::npos;
+      } else {
+        piece_ = sv.substr(start, end - start);
+        next_  = end + (view_->mode_ == mode::exact ? view_->sep_.size() : 1);
+      }
+    }
+
+    const split_view* view_ = nullptr;
+    std::string_view  piece_;
+    std::size_t       next_ = std::string_view::npos; // start of the following piece
+  };
+
+  split_view(std::string_view sv, std::string_view separator, mode m)
+      : sv_{sv}, sep_{separator}, mode_{m} {}
+
+  [[nodiscard]] iterator begin() const { return iterator{this}; }
+  [[nodiscard]] iterator end() const { return iterator{}; }
+
+private:
+  [[nodiscard]] std::size_t find_separator(std::size_t start) const {
+    if (sep_.empty()) return std::string_view::npos;
+    if (mode_ == mode::exact) return sv_.find(sep_, start);
+    return sep_.size() == 1 ? sv_.find(sep_[0], start) : sv_.find_first_of(sep_, start);
+  }
+
+  std::string_view sv_;
+  std::string_view sep_;
+  mode             mode_;
+};
+
+// split on each occurrence of the whole `separator`
+inline split_view split(std::string_view sv, std::string_view separator) {
+  return split_view{sv, separator, split_view::mode::exact};
+}
+
+// split on each occurrence of any one of `delims`
+inline split_view split_any_of(std::string_view sv, std::string_view delims) {
+  return split_view{sv, delims, split_view::mode::any_of};
+}
+
+// materialised versions of split_any_of
 inline std::vector<std::string> explode(const std::string& delims, const std::string& s) {
   std::vector<std::string> pieces;
-  std::size_t              start = 0;
-  auto                     end   = s.find_first_of(delims);
-  while (end != std::string::npos) {
-    pieces.emplace_back(s.substr(start, end - start));
-    start = end + delims.size();
-    end   = s.find_first_of(delims, start);
-  }
-  pieces.emplace_back(s.substr(start));
+  for (auto piece: split_any_of(s, delims)) pieces.emplace_back(piece);
   return pieces;
 }
 
 inline std::vector<std::string_view> explode_sv(const std::string_view& delims,
                                                 const std::string_view& sv) {
   std::vector<std::string_view> pieces;
-  std::size_t                   start = 0;
-  auto                          end   = sv.find_first_of(delims);
-  while (end != std::string::npos) {
-    pieces.emplace_back(sv.substr(start, end - start));
-    start = end + delims.size();
-    end   = sv.find_first_of(delims, start);
-  }
-  pieces.emplace_back(sv.substr(start));
+  for (auto piece: split_any_of(sv, delims)) pieces.emplace_back(piece);
   return pieces;
 }
 
+namespace detail {
+
+// needle.size() >= 1
+inline std::size_t ifind_generic(std::string_view hay, std::string_view needle, std::size_t pos) {
+  for (; pos + needle.size() <= hay.size(); ++pos)
+    if (iequal_generic(hay.data() + pos, needle.data(), needle.size())) return pos; // NOLINT
+  return std::string_view::npos;
+}
+
+#if OS_SIMD_X86
+// Substring search with a SIMD first/last byte filter (W. Mula, "SIMD-friendly algorithms for
+// substring searching"): compare a register of candidate starts against needle[0] and the
+// register k - 1 bytes further on against needle[k - 1], and only memcmp where both match.
+// needle.size() >= 2. returns npos if not found
+OS_TARGET_SSE42 inline std::size_t find_sse42(std::string_view hay, std::string_view needle,
+                                              std::size_t pos) {
+  const std::size_t k     = needle.size();
+  const char*       h     = hay.data();
+  const __m128i     first = _mm_set1_epi8(needle.front());
+  const __m128i     last  = _mm_set1_epi8(needle.back());
+  for (; pos + k - 1 + 16 <= hay.size(); pos += 16) {
+    const __m128i b_first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(h + pos)); // NOLINT
+    const __m128i b_last =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(h + pos + k - 1)); // NOLINT
+    auto mask = static_cast<unsigned>(_mm_movemask_epi8(
+        _mm_and_si128(_mm_cmpeq_epi8(first, b_first), _mm_cmpeq_epi8(last, b_last))));
+    while (mask != 0) {
+      const auto bit = static_cast<std::size_t>(__builtin_ctz(mask));
+      if (std::memcmp(h + pos + bit + 1, needle.data() + 1, k - 2) == 0) return pos + bit; // NOLINT
+      mask &= mask - 1;
+    }
+  }
+  return hay.find(needle, pos);
+}
+
+OS_TARGET_AVX2 inline std::size_t find_avx2(std::string_view hay, std::string_view needle,
+                                            std::size_t pos) {
+  const std::size_t k     = needle.size();
+  const char*       h     = hay.data();
+  const __m256i     first = _mm256_set1_epi8(needle.front());
+  const __m256i     last  = _mm256_set1_epi8(needle.back());
+  for (; pos + k - 1 + 32 <= hay.size(); pos += 32) {
+    const __m256i b_first =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(h + pos)); // NOLINT
+    const __m256i b_last =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(h + pos + k - 1)); // NOLINT
+    auto mask = static_cast<unsigned>(_mm256_movemask_epi8(
+        _mm256_and_si256(_mm256_cmpeq_epi8(first, b_first), _mm256_cmpeq_epi8(last, b_last))));
+    while (mask != 0) {
+      const auto bit = static_cast<std::size_t>(__builtin_ctz(mask));
+      if (std::memcmp(h + pos + bit + 1, needle.data() + 1, k - 2) == 0) return pos + bit; // NOLINT
+      mask &= mask - 1;
+    }
+  }
+  return hay.find(needle, pos);
+}
+
+// The same search on lower cased blocks, verified with a case insensitive compare.
+// needle.size() >= 1
+OS_TARGET_SSE42 inline std::size_t ifind_sse42(std::string_view hay, std::string_view needle,
+                                               std::size_t pos) {
+  const std::size_t k     = needle.size();
+  const char*       h     = hay.data();
+  const __m128i     first = _mm_set1_epi8(ascii::tolower(needle.front()));
+  const __m128i     last  = _mm_set1_epi8(ascii::tolower(needle.back()));
+  for (; pos + k - 1 + 16 <= hay.size(); pos += 16) {
+    const __m128i b_first = change_case_sse42(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(h + pos)), 'A', 'Z'); // NOLINT
+    const __m128i b_last = change_case_sse42(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(h + pos + k - 1)), 'A', 'Z'); // NOLINT
+    auto mask = static_cast<unsigned>(_mm_movemask_epi8(
+        _mm_and_si128(_mm_cmpeq_epi8(first, b_first), _mm_cmpeq_epi8(last, b_last))));
+    while (mask != 0) {
+      const auto bit = static_cast<std::size_t>(__builtin_ctz(mask));
+      if (k <= 2 || iequal_sse42(h + pos + bit + 1, needle.data() + 1, k - 2)) // NOLINT
+        return pos + bit;
+      mask &= mask - 1;
+    }
+  }
+  return ifind_generic(hay, needle, pos);
+}
+
+OS_TARGET_AVX2 inline std::size_t ifind_avx2(std::string_view hay, std::string_view needle,
+                                             std::size_t pos) {
+  const std::size_t k     = needle.size();
+  const char*       h     = hay.data();
+  const __m256i     first = _mm256_set1_epi8(ascii::tolower(needle.front()));
+  const __m256i     last  = _mm256_set1_epi8(ascii::tolower(needle.back()));
+  for (; pos + k - 1 + 32 <= hay.size(); pos += 32) {
+    const __m256i b_first = change_case_avx2(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(h + pos)), 'A', 'Z'); // NOLINT
+    const __m256i b_last = change_case_avx2(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(h + pos + k - 1)), 'A', // NOLINT
+        'Z');
+    auto mask = static_cast<unsigned>(_mm256_movemask_epi8(
+        _mm256_and_si256(_mm256_cmpeq_epi8(first, b_first), _mm256_cmpeq_epi8(last, b_last))));
+    while (mask != 0) {
+      const auto bit = static_cast<std::size_t>(__builtin_ctz(mask));
+      if (k <= 2 || iequal_avx2(h + pos + bit + 1, needle.data() + 1, k - 2)) // NOLINT
+        return pos + bit;
+      mask &= mask - 1;
+    }
+  }
+  return ifind_generic(hay, needle, pos);
+}
+#endif // OS_SIMD_X86
+
+} // namespace detail
+
+// same result as hay.find(needle, pos), faster for long haystacks
+inline std::size_t find_substring(std::string_view hay, std::string_view needle,
+                                  std::size_t pos = 0) {
+  if (needle.size() < 2 || pos >= hay.size()) return hay.find(needle, pos); // memchr
+#if OS_SIMD_X86
+  switch (simd::level()) {
+  case simd::isa::avx2: return detail::find_avx2(hay, needle, pos);
+  case simd::isa::sse42: return detail::find_sse42(hay, needle, pos);
+  case simd::isa::generic: break;
+  }
+#endif
+  return hay.find(needle, pos);
+}
+
+// ASCII case insensitive find_substring
+inline std::size_t ifind(std::string_view hay, std::string_view needle, std::size_t pos = 0) {
+  if (needle.empty()) return pos <= hay.size() ? pos : std::string_view::npos;
+  if (pos >= hay.size()) return std::string_view::npos;
+#if OS_SIMD_X86
+  switch (simd::level()) {
+  case simd::isa::avx2: return detail::ifind_avx2(hay, needle, pos);
+  case simd::isa::sse42: return detail::ifind_sse42(hay, needle, pos);
+  case simd::isa::generic: break;
+  }
+#endif
+  return detail::ifind_generic(hay, needle, pos);
+}
+
+// Replaces non-overlapping occurrences, scanning left to right. When the lengths differ, the
+// matches are counted first and the result is built in one pass into a buffer of the exact
+// size, rather than shifting the tail on every replacement. An empty `search` does nothing.
 inline void replace_all(std::string& subject, const std::string_view& search,
                         const std::string_view& replace) {
-  size_t pos = subject.find(search);
-  while (pos != std::string::npos) {
-    subject.replace(pos, search.size(), replace);
-    pos = subject.find(search, pos + replace.size());
+  if (search.empty()) return;
+  if (search.size() == replace.size()) {
+    for (auto pos = find_substring(subject, search); pos != std::string::npos;
+         pos      = find_substring(subject, search, pos + search.size()))
+      subject.replace(pos, search.size(), replace); // same length, no shifting
+    return;
+  }
+  std::size_t count = 0;
+  for (auto pos = find_substring(subject, search); pos != std::string::npos;
+       pos      = find_substring(subject, search, pos + search.size()))
+    ++count;
+  if (count == 0) return;
+
+  std::string result(subject.size() - count * search.size() + count * replace.size(), '\0');
+  char*       out  = result.data();
+  std::size_t done = 0;
+  for (auto pos = find_substring(subject, search); pos != std::string::npos;
+       pos      = find_substring(subject, search, done)) {
+    out = std::copy(subject.data() + done, subject.data() + pos, out); // NOLINT
+    out = std::copy(replace.begin(), replace.end(), out);
+    done = pos + search.size();
   }
+  std::copy(subject.data() + done, subject.data() + subject.size(), out); // NOLINT
+  subject.swap(result);
 }
 
 inline std::string replace_all_copy(std::string subject, const std::string_view& search,
@@ -279,8 +1378,152 @@ inline std::string replace_all_copy(std::string subject, const std::string_view&
   return subject;
 }
 
+// Many search => replace pairs applied in one scan of the subject (Aho-Corasick automaton).
+// Matches are leftmost and, among those starting at the same position, longest. They do not
+// overlap and replaced text is not rescanned. Build once, apply many times.
+//   auto r = multi_replacer{{"{{name}}", name}, {"{{date}}", date}};
+//   std::string page = r.apply(tmpl);
+class multi_replacer {
+public:
+  using pair_t = std::pair<std::string_view, std::string_view>;
+
+  multi_replacer(std::initializer_list<pair_t> pairs)
+      : multi_replacer(pairs.begin(), pairs.end()) {}
+
+  // range of pair-likes with .first / .second convertible to std::string_view
+  template <typename InputIt>
+  multi_replacer(InputIt first, InputIt last) {
+    for (; first != last; ++first) add(first->first, first->second);
+    build();
+  }
+
+  [[nodiscard]] std::string apply(std::string_view subject) const {
+    std::string out;
+    out.reserve(subject.size());
+
+    const std::size_t size         = subject.size();
+    std::size_t       copied       = 0; // subject[copied, ) is not yet in `out`
+    std::size_t       i            = 0; // next char to feed the automaton
+    index_t           state        = 0;
+    std::size_t       best_start   = std::string_view::npos;
+    index_t           best_pattern = none;
+
+    auto commit = [&] {
+      out.append(subject.substr(copied, best_start - copied));
+      out.append(replace_[best_pattern]);
+      copied     = best_start + search_[best_pattern].size();
+      i          = copied; // restart after the replaced text
+      state      = 0;
+      best_start = std::string_view::npos;
+    };
+
+    while (i != size) {
+      state              = next(state, subject[i++]);
+      const node_t& node = nodes_[state];
+      // the first pattern on the output chain is the longest one ending here
+      if (const index_t out_node = node.pattern != none ? state : node.dict; out_node != none) {
+        const index_t     p     = nodes_[out_node].pattern;
+        const std::size_t start = i - search_[p].size();
+        if (start < best_start ||
+            (start == best_start && search_[p].size() > search_[best_pattern].size())) {
+          best_start   = start;
+          best_pattern = p;
+        }
+      }
+      // commit when no later match can start at or before best_start
+      if (best_start != std::string_view::npos && (i - node.depth > best_start || i == size))
+        commit();
+    }
+    out.append(subject.substr(copied));
+    return out;
+  }
+
+private:
+  using index_t                 = std::uint32_t;
+  static constexpr index_t none = ~index_t{0};
+
+  struct node_t {
+    index_t     pattern = none; // the pattern ending exactly here
+    index_t     dict    = none; // nearest node on the fail chain which ends a pattern
+    index_t     fail    = 0;
+    std::size_t depth   = 0;
+  };
+
+  void add(std::string_view search, std::string_view replace) {
+    if (search.empty()) return;
+    if (std::find(search_.begin(), search_.end(), search) != search_.end()) return; // first wins
+    search_.emplace_back(search);
+    replace_.emplace_back(replace);
+  }
+
+  [[nodiscard]] std::size_t edge(index_t state, char c) const {
+    return state * alphabet_ + class_[static_cast<unsigned char>(c)];
+  }
+
+  [[nodiscard]] index_t next(index_t state, char c) const { return delta_[edge(state, c)]; }
+
+  void build() {
+    // bytes which occur in patterns get their own class, all others share class 0
+    alphabet_ = 1;
+    for (const auto& search: search_)
+      for (char c: search)
+        if (auto& cls = class_[static_cast<unsigned char>(c)]; cls == 0)
+          cls = static_cast<std::uint8_t>(alphabet_++);
+
+    // trie, `none` for missing edges
+    nodes_.assign(1, node_t{});
+    delta_.assign(alphabet_, none);
+    for (index_t p = 0; p != search_.size(); ++p) {
+      index_t state = 0;
+      for (char c: search_[p]) {
+        if (delta_[edge(state, c)] == none) {
+          delta_[edge(state, c)] = static_cast<index_t>(nodes_.size());
+          nodes_.push_back(node_t{none, none, 0, nodes_[state].depth + 1});
+          delta_.resize(delta_.size() + alphabet_, none);
+        }
+        state = delta_[edge(state, c)];
+      }
+      nodes_[state].pattern = p;
+    }
+
+    // breadth first: fail and dictionary links, and the complete transition table
+    std::vector<index_t> queue;
+    for (std::size_t c = 0; c != alphabet_; ++c) {
+      if (delta_[c] == none)
+        delta_[c] = 0;
+      else
+        queue.push_back(delta_[c]);
+    }
+    for (std::size_t head = 0; head != queue.size(); ++head) {
+      const index_t u = queue[head];
+      for (std::size_t c = 0; c != alphabet_; ++c) {
+        index_t&      v        = delta_[u * alphabet_ + c];
+        const index_t fail_dst = delta_[nodes_[u].fail * alphabet_ + c];
+        if (v == none) {
+          v = fail_dst;
+        } else {
+          nodes_[v].fail = fail_dst;
+          nodes_[v].dict = nodes_[fail_dst].pattern != none ? fail_dst : nodes_[fail_dst].dict;
+          queue.push_back(v);
+        }
+      }
+    }
+  }
+
+  std::vector<std::string>      search_;
+  std::vector<std::string>      replace_;
+  std::vector<node_t>           nodes_;
+  std::vector<index_t>          delta_; // nodes_.size() x alphabet_
+  std::array<std::uint8_t, 256> class_{};
+  std::size_t                   alphabet_ = 1;
+};
+
 inline bool contains(std::string_view needle, std::string_view s) {
-  return s.find(needle) != std::string::npos;
+  return find_substring(s, needle) != std::string::npos;
+}
+
+inline bool icontains(std::string_view needle, std::string_view s) {
+  return ifind(s, needle) != std::string::npos;
 }
 
 template <typename InputIt>
@@ -301,18 +1544,15 @@ std::ostream& join(std::ostream& stream, InputIt begin, InputIt end, const std::
 }
 
 template <typename T>
-std::string stringify(T t) {
-  std::stringstream s;
-  s << t;
-  return s.str();
+std::string stringify(const T& t) {
+  return (string_builder{} << t).str();
 }
 
 template <typename InputIt>
-std::string join(InputIt begin, InputIt end, const std::string& glue = ", ",
-                 const std::string& term = "") {
-  std::ostringstream ss;
-  join(ss, begin, end, glue, term);
-  return ss.str();
+std::string join(InputIt begin, InputIt end, std::string_view glue = ", ",
+                 std::string_view term = "") {
+  string_builder b;
+  return join(b, begin, end, glue, term).str();
 }
 
 template <typename Container>
@@ -322,10 +1562,8 @@ std::ostream& join(std::ostream& stream, Container cont, const std::string& glue
 }
 
 template <typename Container>
-std::string join(Container cont, const std::string& glue = ", ", const std::string& term = "") {
-  std::ostringstream ss;
-  join(ss, std::begin(cont), std::end(cont), glue, term);
-  return ss.str(); // can't call this on the rvalue above LWG#1203
+std::string join(const Container& cont, std::string_view glue = ", ", std::string_view term = "") {
+  return join(std::begin(cont), std::end(cont), glue, term);
 }
 
 } // namespace os::str
@@ -0,0 +1,229 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+namespace os::str {
+
+namespace detail {
+
+// char, signed char and unsigned char (eg std::uint8_t) are written as characters, as an
+// ostream does, not as numbers
+template <typename T>
+constexpr bool is_char_v = std::is_same_v<T, char> || std::is_same_v<T, signed char> ||
+                           std::is_same_v<T, unsigned char>;
+
+template <typename Sink, typename = void>
+struct is_append_sink : std::false_type {};
+
+template <typename Sink>
+struct is_append_sink<Sink,
+                      std::void_t<decltype(std::declval<Sink&>().append(std::string_view{}))>>
+    : std::true_type {};
+
+// strings as they are, numbers with std::to_chars, anything else through its operator<<
+template <typename Sink, typename T>
+void append_to(Sink& sink, const T& value) {
+  if constexpr (std::is_convertible_v<const T&, std::string_view>) {
+    sink.append(std::string_view(value));
+  } else if constexpr (is_char_v<T>) {
+    const auto c = static_cast<char>(value);
+    sink.append(std::string_view(&c, 1));
+  } else if constexpr (std::is_arithmetic_v<T> && !std::is_same_v<T, bool>) {
+    std::array<char, 64> buf{}; // NOLINT enough for any integer or shortest double
+    const auto res = std::to_chars(buf.data(), buf.data() + buf.size(), value);
+    sink.append(std::string_view(buf.data(), static_cast<std::size_t>(res.ptr - buf.data())));
+  } else {
+    std::ostringstream ss;
+    ss << value;
+    sink.append(ss.str());
+  }
+}
+
+} // namespace detail
+
+// Growable character buffer for building output: the first `inline_capacity` characters are
+// stored in the object itself, so a typical line needs no heap allocation until str() copies
+// it out, or none at all if only view() is used. Numbers are formatted with std::to_chars
+// straight into the buffer. It is a sink for join() and append_to() like std::string.
+class string_builder {
+public:
+  static constexpr std::size_t inline_capacity = 256;
+
+  string_builder() = default;
+
+  string_builder(const string_builder& other) { append(other.view()); }
+  string_builder& operator=(const string_builder& other) {
+    if (this != &other) {
+      clear();
+      append(other.view());
+    }
+    return *this;
+  }
+
+  // a heap buffer is taken over, inline contents are copied
+  string_builder(string_builder&& other) noexcept { *this = std::move(other); }
+  string_builder& operator=(string_builder&& other) noexcept {
+    if (this == &other) return *this;
+    if (other.heap_) {
+      heap_     = std::move(other.heap_);
+      data_     = heap_.get();
+      capacity_ = std::exchange(other.capacity_, inline_capacity);
+      other.data_ = other.inline_.data();
+    } else {
+      heap_.reset();
+      data_     = inline_.data();
+      capacity_ = inline_capacity;
+      std::memcpy(data_, other.data_, other.size_);
+    }
+    size_ = std::exchange(other.size_, 0);
+    return *this;
+  }
+
+  ~string_builder() = default;
+
+  [[nodiscard]] std::string_view view() const { return {data_, size_}; }
+  [[nodiscard]] std::string      str() const { return std::string(view()); }
+  [[nodiscard]] const char*      data() const { return data_; }
+  [[nodiscard]] std::size_t      size() const { return size_; }
+  [[nodiscard]] bool             empty() const { return size_ == 0; }
+  [[nodiscard]] std::size_t      capacity() const { return capacity_; }
+
+  // keeps the buffer
+  void clear() { size_ = 0; }
+
+  void reserve(std::size_t n) {
+    if (n <= capacity_) return;
+    const std::size_t cap  = std::max(n, 2 * capacity_);
+    auto              heap = std::make_unique<char[]>(cap); // NOLINT
+    std::memcpy(heap.get(), data_, size_);
+    heap_     = std::move(heap);
+    data_     = heap_.get();
+    capacity_ = cap;
+  }
+
+  string_builder& append(std::string_view sv) {
+    reserve(size_ + sv.size());
+    std::memcpy(data_ + size_, sv.data(), sv.size()); // NOLINT
+    size_ += sv.size();
+    return *this;
+  }
+
+  string_builder& append(char c, std::size_t count = 1) {
+    reserve(size_ + count);
+    std::memset(data_ + size_, c, count); // NOLINT
+    size_ += count;
+    return *this;
+  }
+
+  // integers, and floating point in the shortest form that reads back exactly
+  template <typename T, typename = std::enable_if_t<std::is_arithmetic_v<T> &&
+                                                    !std::is_same_v<T, bool> &&
+                                                    !detail::is_char_v<T>>>
+  string_builder& append(T value) {
+    return format([&](char* first, char* last) { return std::to_chars(first, last, value); });
+  }
+
+  // like printf("%.*f", precision, value)
+  string_builder& append_fixed(double value, int precision) {
+    return format([&](char* first, char* last) {
+      return std::to_chars(first, last, value, std::chars_format::fixed, precision);
+    });
+  }
+
+  // `s` right aligned in a field of `width` characters
+  string_builder& lpad(std::string_view s, std::size_t width, char fill = ' ') {
+    if (s.size() < width) append(fill, width - s.size());
+    return append(s);
+  }
+
+  // `s` left aligned in a field of `width` characters
+  string_builder& rpad(std::string_view s, std::size_t width, char fill = ' ') {
+    append(s);
+    if (s.size() < width) append(fill, width - s.size());
+    return *this;
+  }
+
+  template <typename Container>
+  string_builder& join(const Container& cont, std::string_view glue = ", ",
+                       std::string_view term = "");
+
+  // anything else through its operator<<
+  template <typename T>
+  string_builder& operator<<(const T& value) {
+    if constexpr (std::is_arithmetic_v<T> && !std::is_same_v<T, bool> &&
+                  !detail::is_char_v<T>) {
+      return append(value);
+    } else {
+      detail::append_to(*this, value);
+      return *this;
+    }
+  }
+
+private:
+  // to_chars into the free space, growing until it fits
+  template <typename ToChars>
+  string_builder& format(ToChars&& to_chars) {
+    reserve(size_ + 32); // NOLINT any integer or shortest double
+    for (;;) {
+      const auto res = to_chars(data_ + size_, data_ + capacity_); // NOLINT
+      if (res.ec == std::errc{}) {
+        size_ = static_cast<std::size_t>(res.ptr - data_);
+        return *this;
+      }
+      reserve(2 * capacity_);
+    }
+  }
+
+  std::array<char, inline_capacity> inline_; // NOLINT not initialised, only [0, size_) is read
+  std::unique_ptr<char[]>           heap_;   // NOLINT
+  char*                             data_     = inline_.data();
+  std::size_t                       size_     = 0;
+  std::size_t                       capacity_ = inline_capacity;
+};
+
+// join into any sink with .append(string_view), eg a std::string or an os::fs::FileWriter,
+// without an intermediate stringstream. Numbers are formatted with std::to_chars.
+template <typename Sink, typename InputIt,
+          typename = std::enable_if_t<detail::is_append_sink<Sink>::value>>
+Sink& join(Sink& sink, InputIt begin, InputIt end, std::string_view glue = ", ",
+           std::string_view term = "") {
+  if (begin != end) {
+    detail::append_to(sink, *begin);
+    while (++begin != end) {
+      sink.append(glue);
+      detail::append_to(sink, *begin);
+    }
+  }
+  sink.append(term);
+  return sink;
+}
+
+// string like containers are taken to be the glue of the iterator overloads
+template <typename Sink, typename Container,
+          typename = std::enable_if_t<detail::is_append_sink<Sink>::value &&
+                                      !std::is_convertible_v<const Container&, std::string_view>>,
+          typename = decltype(std::begin(std::declval<const Container&>()))>
+Sink& join(Sink& sink, const Container& cont, std::string_view glue = ", ",
+           std::string_view term = "") {
+  return join(sink, std::begin(cont), std::end(cont), glue, term);
+}
+
+template <typename Container>
+string_builder& string_builder::join(const Container& cont, std::string_view glue,
+                                     std::string_view term) {
+  return os::str::join(*this, std::begin(cont), std::end(cont), glue, term);
+}
+
+} // namespace os::str
@@ -1,3 +1,6 @@
+#pragma once
+
+#include <iterator>
 #include <type_traits>
 
 namespace os::tmp {
@@ -22,4 +25,18 @@ struct is_optional : std::false_type {};
 template <typename T>
 struct is_optional<T, std::void_t<decltype(std::declval<T>().value())>> : std::true_type {};
 
+// contiguous storage, ie std::data() and std::size() are usable (vector, array, string..)
+template <typename C, typename = void>
+struct is_contiguous : std::false_type {};
+
+template <typename C>
+struct is_contiguous<
+    C, std::void_t<decltype(std::data(std::declval<C&>())), decltype(std::size(std::declval<C&>()))>>
+    : std::true_type {};
+
+// element type of a container or range, without cv qualifiers
+template <typename C>
+using value_type_t =
+    std::remove_cv_t<std::remove_reference_t<decltype(*std::begin(std::declval<C&>()))>>;
+
 } // namespace os::tmp
@@ -0,0 +1,48 @@
+// compares the throwing, strtol based os::str::parse with os::str::try_parse
+// usage: parse_bench [count]
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "os/bch.hpp"
+#include "os/str.hpp"
+
+template <typename Gen>
+std::vector<std::string> make_fields(std::size_t count, Gen&& gen) {
+  std::vector<std::string> fields;
+  fields.reserve(count);
+  for (std::size_t i = 0; i != count; ++i) fields.push_back(std::to_string(gen()));
+  return fields;
+}
+
+template <typename T>
+void compare(const std::string& type, const std::vector<std::string>& fields) {
+  using sum_t = std::conditional_t<std::is_integral_v<T>, std::int64_t, double>;
+  sum_t sum_parse{};
+  {
+    os::bch::Timer t("parse<" + type + ">");
+    for (const auto& f: fields) sum_parse += os::str::parse<T>(f.c_str(), f.size());
+  }
+  sum_t sum_try{};
+  {
+    os::bch::Timer t("try_parse<" + type + ">");
+    for (const auto& f: fields) sum_try += os::str::try_parse<T>(f.data(), f.size()).value;
+  }
+  if (sum_parse != sum_try) std::cerr << type << ": results differ\n";
+}
+
+int main(int argc, char* argv[]) {
+  const std::size_t count = argc > 1 ? std::stoul(argv[1]) : 5'000'000; // NOLINT
+
+  std::mt19937_64 rng(42); // NOLINT
+  std::uniform_int_distribution<int>     ints(-1'000'000, 1'000'000);
+  std::uniform_int_distribution<long>    longs(-1'000'000'000'000L, 1'000'000'000'000L);
+  std::uniform_real_distribution<double> doubles(-1e6, 1e6); // NOLINT
+
+  compare<int>("int", make_fields(count, [&] { return ints(rng); }));
+  compare<long>("long", make_fields(count, [&] { return longs(rng); }));
+  compare<double>("double", make_fields(count, [&] { return doubles(rng); }));
+}
@@ -0,0 +1,54 @@
+// compares StreamingReader (pread threads, optionally O_DIRECT) with MemoryMappedFile for one
+// line counting pass over a large file, with a cold and a warm page cache. The file is generated
+// if missing or too small.
+// usage: stream_bench [file] [size_mb]
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+#include "bench_files.hpp"
+#include "os/bch.hpp"
+#include "os/fs.hpp"
+
+// the parsing code shared by both backends
+std::size_t count_lines(std::string_view chunk) {
+  std::size_t count = 0;
+  for ([[maybe_unused]] auto line: os::fs::lines(chunk)) ++count;
+  return count;
+}
+
+std::size_t run_mmap(const std::string& label, const std::string& filename) {
+  os::bch::Timer           t(label);
+  os::fs::MemoryMappedFile mmf(filename, {os::fs::access::sequential});
+  return count_lines(mmf.get_buffer());
+}
+
+std::size_t run_stream(const std::string& label, const std::string& filename, bool direct) {
+  os::bch::Timer          t(label);
+  os::fs::StreamingReader reader(filename, {4UL << 20U, 4, direct});
+  std::size_t             count = 0;
+  reader.for_each_chunk([&](std::string_view chunk) { count += count_lines(chunk); });
+  if (direct && !reader.direct()) std::cerr << "  (O_DIRECT not supported here)\n";
+  return count;
+}
+
+int main(int argc, char* argv[]) {
+  const std::string filename = argc > 1 ? argv[1] : "stream_bench.dat";
+  const std::size_t size_mb  = argc > 2 ? std::stoul(argv[2]) : 4096; // NOLINT
+  generate(filename, size_mb << 20U);
+
+  drop_cache(filename);
+  const std::size_t expected = run_mmap("mmap cold", filename);
+  bool              ok       = true;
+  auto              check    = [&](std::size_t count) { ok = ok && count == expected; };
+  check(run_mmap("mmap warm", filename));
+  drop_cache(filename);
+  check(run_stream("pread cold", filename, false));
+  check(run_stream("pread warm", filename, false));
+  drop_cache(filename);
+  check(run_stream("O_DIRECT", filename, true));
+
+  std::cout << "lines: " << expected << (ok ? "" : "  MISMATCH") << '\n';
+  return ok ? 0 : 1;
+}
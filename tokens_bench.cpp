@@ -0,0 +1,96 @@
+// checks that scan_tokens produces the same tokens as for_each_token with the empty tokens
+// dropped, and compares their speed. The corpus is random text with bytes >= 0x80 mixed in,
+// followed by hand made cases with separators at every offset around 16/32/64 byte boundaries.
+// usage: tokens_bench [size_mb]
+#include <cstddef>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "os/bch.hpp"
+#include "os/str.hpp"
+
+std::string make_corpus(std::size_t size) {
+  std::mt19937                    rng(42); // NOLINT
+  std::uniform_int_distribution<> kind(0, 99);
+  std::uniform_int_distribution<> byte(0, 255);
+  std::uniform_int_distribution<> letter('a', 'z');
+  std::string                     corpus;
+  corpus.reserve(size + 64 * 64 * 4);
+  while (corpus.size() < size) {
+    const int k = kind(rng);
+    if (k < 80) // NOLINT mostly words
+      corpus += static_cast<char>(letter(rng));
+    else if (k < 95) // NOLINT
+      corpus += ' ';
+    else
+      corpus += static_cast<char>(byte(rng)); // punctuation, control and UTF-8 like bytes
+  }
+  // one separator (a space, or a byte >= 0x80) at every offset of a block and its neighbours
+  for (const char sep: {' ', '\xC3'}) {
+    for (std::size_t at = 0; at != 3 * 64; ++at) {
+      std::string block(3 * 64, 'x');
+      block[at] = sep;
+      corpus += block;
+    }
+  }
+  corpus += ' '; // for_each_token drops a last token without a separator after it
+  return corpus;
+}
+
+template <typename Predicate>
+std::vector<std::string_view> reference_tokens(std::string_view corpus, const Predicate& pred) {
+  std::vector<std::string_view> tokens;
+  os::str::for_each_token(
+      corpus,
+      [&](std::string_view token) {
+        if (!token.empty()) tokens.push_back(token);
+      },
+      pred);
+  return tokens;
+}
+
+std::vector<std::string_view> scanned_tokens(std::string_view        corpus,
+                                             const os::str::charset& token_chars) {
+  std::vector<std::string_view> tokens;
+  os::str::scan_tokens(
+      corpus, [&](std::string_view token) { tokens.push_back(token); }, token_chars);
+  return tokens;
+}
+
+int main(int argc, char* argv[]) {
+  const std::size_t size_mb = argc > 1 ? std::stoul(argv[1]) : 256; // NOLINT
+  const std::string corpus  = make_corpus(size_mb << 20U);
+
+  bool same = true;
+  // letters, and everything but whitespace, which includes all bytes >= 0x80
+  const auto not_space = [](char c) { return !os::str::ascii::isspace(c); };
+  for (const bool words: {true, false}) {
+    const os::str::charset token_chars =
+        words ? os::str::charsets::alpha : ~os::str::charsets::space;
+    const auto expected = words ? reference_tokens(corpus, os::str::ascii::isalpha)
+                                : reference_tokens(corpus, not_space);
+    same = same && expected == scanned_tokens(corpus, token_chars);
+
+    // timed without collecting the tokens
+    std::size_t count_each = 0;
+    std::size_t count_scan = 0;
+    {
+      os::bch::Timer t(words ? "for_each_token alpha" : "for_each_token !space");
+      auto           count = [&](std::string_view token) { count_each += token.empty() ? 0 : 1; };
+      if (words)
+        os::str::for_each_token(corpus, count, os::str::ascii::isalpha);
+      else
+        os::str::for_each_token(corpus, count, not_space);
+    }
+    {
+      os::bch::Timer t(words ? "scan_tokens alpha" : "scan_tokens !space");
+      os::str::scan_tokens(corpus, [&](std::string_view) { ++count_scan; }, token_chars);
+    }
+    std::cout << count_each << " / " << count_scan << " tokens\n";
+  }
+  if (!same) std::cerr << "tokens differ\n";
+  return same ? 0 : 1;
+}
@@ -0,0 +1,76 @@
+// compares the string_view trim of a find_first_not_of(ascii::spacechars()) scan with
+// os::str::trim, both its whitespace default and an explicit charset, on short CSV like fields
+// with a few blanks and on fields padded by long blank runs. Each call trims all the fields.
+// usage: trim_bench [fields]
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "os/bch.hpp"
+#include "os/str.hpp"
+
+// the trim before charsets, as a reference
+std::string_view trim_not_of(std::string_view sv) {
+  const std::string_view spaces = os::str::ascii::spacechars();
+  const auto             last   = sv.find_last_not_of(spaces);
+  if (last != std::string_view::npos) sv.remove_suffix(sv.size() - last - 1);
+  sv.remove_prefix(std::min(sv.find_first_not_of(spaces), sv.size()));
+  return sv;
+}
+
+std::vector<std::string> make_fields(std::size_t count, std::size_t max_blanks) {
+  std::mt19937                    rng(42); // NOLINT
+  std::uniform_int_distribution<> blanks(0, static_cast<int>(max_blanks));
+  std::uniform_int_distribution<> len(0, 12); // NOLINT
+  std::uniform_int_distribution<> ws(0, 5);   // NOLINT
+  std::uniform_int_distribution<> letter('a', 'z');
+  const std::string_view          spaces = os::str::ascii::spacechars();
+
+  std::vector<std::string> fields(count);
+  for (auto& f: fields) {
+    for (int i = blanks(rng); i != 0; --i) f += spaces[static_cast<std::size_t>(ws(rng))];
+    for (int i = len(rng); i != 0; --i) f += static_cast<char>(letter(rng));
+    for (int i = blanks(rng); i != 0; --i) f += spaces[static_cast<std::size_t>(ws(rng))];
+  }
+  return fields;
+}
+
+template <typename Trim>
+std::size_t trim_all(const std::vector<std::string>& fields, const Trim& trim) {
+  std::size_t total = 0;
+  for (const auto& f: fields) total += trim(std::string_view(f)).size();
+  return total;
+}
+
+int main(int argc, char* argv[]) {
+  const std::size_t count = argc > 1 ? std::stoul(argv[1]) : 4096; // NOLINT
+
+  const auto trim_space   = [](std::string_view sv) { return os::str::trim(sv); };
+  const auto trim_charset = [](std::string_view sv) {
+    return os::str::trim(sv, os::str::charsets::space);
+  };
+
+  bool           same = true;
+  os::bch::Bench bench;
+  for (const std::size_t max_blanks: {std::size_t{2}, std::size_t{600}}) {
+    const auto fields = make_fields(count, max_blanks);
+    for (const auto& f: fields)
+      same = same && trim_not_of(f) == trim_space(f) && trim_not_of(f) == trim_charset(f);
+
+    const std::string     runs = max_blanks > 16 ? " long" : " short";
+    const os::bch::bench_work work{0, fields.size()};
+    bench.run("find_not_of" + runs,
+              [&] { os::bch::do_not_optimize(trim_all(fields, trim_not_of)); }, work);
+    bench.run("trim" + runs, [&] { os::bch::do_not_optimize(trim_all(fields, trim_space)); },
+              work);
+    bench.run("trim(charset)" + runs,
+              [&] { os::bch::do_not_optimize(trim_all(fields, trim_charset)); }, work);
+  }
+  bench.print_table();
+  if (!same) std::cerr << "results differ\n";
+  return same ? 0 : 1;
+}
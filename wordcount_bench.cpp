@@ -0,0 +1,136 @@
+// counts word frequencies in a generated corpus: std::unordered_map<std::string> with
+// trim_lower per token, against os::str::word_counter, single threaded and with one counter per
+// thread merged at the end. The file is generated if missing or too small.
+// usage: wordcount_bench [file] [size_mb] [threads]
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <sys/stat.h>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "os/bch.hpp"
+#include "os/fs.hpp"
+#include "os/str.hpp"
+
+using top_t = std::vector<std::pair<std::string, std::uint64_t>>;
+
+constexpr std::size_t top_k = 10;
+
+// lower case words with a roughly Zipf distributed vocabulary, some punctuation, short lines
+void generate(const std::string& filename, std::size_t size) {
+  struct stat sbuf {};
+  if (stat(filename.c_str(), &sbuf) == 0 && static_cast<std::size_t>(sbuf.st_size) >= size) return;
+
+  std::cerr << "generating " << (size >> 20U) << " MB in " << filename << '\n';
+  constexpr std::size_t    vocabulary = 200'000;
+  std::mt19937_64          rng(42); // NOLINT
+  std::vector<std::string> words(vocabulary);
+  std::uniform_int_distribution<> len(2, 12);  // NOLINT
+  std::uniform_int_distribution<> letter('a', 'z');
+  for (auto& w: words) {
+    w.resize(static_cast<std::size_t>(len(rng)));
+    for (auto& c: w) c = static_cast<char>(letter(rng));
+  }
+
+  // rank = vocabulary^u is log uniform, ie frequency ~ 1 / rank
+  std::uniform_real_distribution<> u(0.0, 1.0);
+  std::uniform_int_distribution<>  sep(0, 15); // NOLINT
+  const double                     log_vocabulary = std::log(static_cast<double>(vocabulary));
+  os::fs::FileWriter               out(filename);
+  for (std::size_t written = 0; written < size;) {
+    const auto rank = static_cast<std::size_t>(std::exp(u(rng) * log_vocabulary)) - 1;
+    const auto& w   = words[std::min(rank, vocabulary - 1)];
+    out.append(w);
+    const int s = sep(rng);
+    out.append(std::string_view(s == 0 ? ", " : s == 1 ? ".\n" : " "));
+    written += w.size() + (s < 2 ? 2 : 1);
+  }
+}
+
+template <typename Counts>
+top_t top_of(const Counts& counts) {
+  top_t top;
+  for (const auto& [w, n]: counts) top.emplace_back(std::string(w), n);
+  const std::size_t k = std::min(top_k, top.size());
+  std::partial_sort(top.begin(), top.begin() + static_cast<std::ptrdiff_t>(k), top.end(),
+                    [](const auto& a, const auto& b) {
+                      return a.second != b.second ? a.second > b.second : a.first < b.first;
+                    });
+  top.resize(k);
+  return top;
+}
+
+top_t top_of(const os::str::word_counter& counter) {
+  top_t top;
+  for (const auto& [w, n]: counter.top(top_k)) top.emplace_back(std::string(w), n);
+  return top;
+}
+
+int main(int argc, char* argv[]) {
+  const std::string filename = argc > 1 ? argv[1] : "wordcount_bench.txt";
+  const std::size_t size_mb  = argc > 2 ? std::stoul(argv[2]) : 2048; // NOLINT
+  const auto        threads  = static_cast<unsigned>(argc > 3 ? std::stoul(argv[3]) : 0);
+  const unsigned    n = threads != 0 ? threads : std::max(1U, std::thread::hardware_concurrency());
+  generate(filename, size_mb << 20U);
+
+  // prefaulted, so the timings are of the counting
+  const os::fs::MemoryMappedFile file(filename, {os::fs::access::sequential, false, true});
+  const std::string_view         buffer = file.get_buffer();
+
+  // one word in 16 ends a line, so there is work for every thread. Well below that rate, eg a
+  // stale file without newlines, the per thread run would silently be single threaded
+  const auto lines     = static_cast<std::size_t>(std::count(buffer.begin(), buffer.end(), '\n'));
+  const auto min_lines = buffer.size() / 12 / 16 / 2; // NOLINT at most ~12 bytes per word
+  if (lines < min_lines) {
+    std::cerr << filename << ": " << lines << " lines, expected at least " << min_lines
+              << ", delete it to regenerate\n";
+    return 1;
+  }
+
+  std::vector<top_t> tops;
+  std::size_t        chunks = 0; // of the per thread run that had words
+  {
+    os::bch::Timer                                 t("unordered_map + trim_lower");
+    std::unordered_map<std::string, std::uint64_t> counts;
+    os::str::for_each_token(buffer, [&](std::string_view token) {
+      if (auto word = os::str::trim_lower(token)) ++counts[*word];
+    });
+    tops.push_back(top_of(counts));
+  }
+  {
+    os::bch::Timer        t("word_counter");
+    os::str::word_counter counter;
+    os::str::scan_tokens(buffer, [&](std::string_view word) { counter.add(word); });
+    tops.push_back(top_of(counter));
+  }
+  {
+    os::bch::Timer t("word_counter per thread + merge");
+    std::vector<os::str::word_counter> counters(n);
+    std::vector<char>                  used(n); // not vector<bool>, written concurrently
+    os::fs::parallel_for_each_chunk(
+        buffer,
+        [&](std::size_t i, std::string_view chunk) {
+          used[i] = chunk.empty() ? 0 : 1;
+          os::str::scan_tokens(chunk, [&](std::string_view word) { counters[i].add(word); });
+        },
+        n, n);
+    for (std::size_t i = 1; i < counters.size(); ++i) counters[0].merge(counters[i]);
+    tops.push_back(top_of(counters[0]));
+    chunks = static_cast<std::size_t>(std::count(used.begin(), used.end(), 1));
+    if (chunks < n) std::cerr << "only " << chunks << " of " << n << " chunks had work\n";
+  }
+
+  for (const auto& [w, count]: tops[0]) std::cout << count << '\t' << w << '\n';
+  const bool same =
+      std::all_of(tops.begin(), tops.end(), [&](const auto& t) { return t == tops[0]; });
+  if (!same) std::cerr << "results differ\n";
+  return same && chunks == n ? 0 : 1;
+}